@@ -1,67 +1,22 @@
 /**
  * @file main.cpp
- * @brief Example application using the RpiFastIrq library with a Lock-Free Ring Buffer.
+ * @brief Example application using the RpiFastIrq library with a lock-free SPSC queue.
  */
 
 #include <iostream>
 #include <atomic>
 #include <csignal>
-#include <thread>
-#include <chrono>
 #include "RpiFastIrq.hpp"
-
-// ============================================================================
-// LOCK-FREE RING BUFFER IMPLEMENTATION
-// ============================================================================
-// This allows the high-priority IRQ thread to pass data to the main printing 
-// thread without using mutexes, preventing any I/O blocking or latency.
-template <typename T, size_t Size>
-class LockFreeRingBuffer {
-private:
-    T m_data[Size];
-    std::atomic<size_t> m_head{0}; // Written by Producer (IRQ Callback)
-    std::atomic<size_t> m_tail{0}; // Read by Consumer (Main Loop)
-
-public:
-    // Pushes an item into the buffer. Returns false if full.
-    bool push(const T& item) {
-        size_t current_head = m_head.load(std::memory_order_relaxed);
-        
-        // Check if buffer is full
-        if (current_head - m_tail.load(std::memory_order_acquire) >= Size) {
-            return false; // Buffer overflow! Event dropped.
-        }
-        
-        m_data[current_head % Size] = item;
-        
-        // Release memory order ensures the data write completes before the head increments
-        m_head.store(current_head + 1, std::memory_order_release);
-        return true;
-    }
-
-    // Pops an item from the buffer. Returns false if empty.
-    bool pop(T& item) {
-        size_t current_tail = m_tail.load(std::memory_order_relaxed);
-        
-        // Check if buffer is empty
-        if (current_tail == m_head.load(std::memory_order_acquire)) {
-            return false; 
-        }
-        
-        item = m_data[current_tail % Size];
-        
-        // Release memory order ensures the data read completes before the tail increments
-        m_tail.store(current_tail + 1, std::memory_order_release);
-        return true;
-    }
-};
+#include "SpscQueue.hpp"
 
 // ============================================================================
 // GLOBAL STATE & SIGNAL HANDLING
 // ============================================================================
 
-// Global buffer to hold up to 1024 pending interrupts
-LockFreeRingBuffer<GpioIrqEvent, 1024> g_event_buffer;
+// Global queue to hold up to 1024 pending interrupts. It lets the
+// high-priority IRQ thread pass data to the main printing thread without
+// mutexes, so console I/O never blocks the listener.
+SpscQueue<GpioIrqEvent, 1024> g_event_buffer;
 
 // Flag to keep the main application running
 std::atomic<bool> g_keep_running{true};
@@ -70,6 +25,8 @@ std::atomic<bool> g_keep_running{true};
 void signal_handler([[maybe_unused]] int signum) {
     std::cout << "\n[Main] Shutdown signal received. Exiting safely...\n";
     g_keep_running = false;
+    // Unblock the main thread if it is waiting for events
+    g_event_buffer.wake();
 }
 
 // ============================================================================
@@ -105,22 +62,23 @@ int main() {
 
     std::cout << "[Main] Listening for interrupts on CPU 3. Press Ctrl+C to stop.\n";
     std::cout << "--------------------------------------------------------------\n";
-    std::cout << "EVENT #\t\tTIMESTAMP (ns)\n";
+    std::cout << "EVENT #\t\tPIN\tTIMESTAMP (ns)\n";
     std::cout << "--------------------------------------------------------------\n";
 
     // The Consumer Loop (Main Thread)
-    GpioIrqEvent received_event;
+    GpioIrqEvent received_events[64];
     
     while (g_keep_running) {
-        // Try to pop an event from the buffer
-        if (g_event_buffer.pop(received_event)) {
+        // Sleep until the callback pushes (no CPU used while idle), then take
+        // everything that is pending in one go. The timeout bounds the exit
+        // delay when Ctrl+C lands just before the wait starts.
+        size_t count = g_event_buffer.wait_pop_n(received_events, 64, 100);
+        for (size_t i = 0; i < count; ++i) {
             // We got an event! We can print it here safely without blocking the ISR.
+            const GpioIrqEvent& received_event = received_events[i];
             std::cout << received_event.event_counter << "\t\t"
-                      << received_event.timestamp_ns << "\n";
-        } else {
-            // Buffer is empty. Sleep for a short time to avoid 100% CPU usage
-            // on the main thread while waiting for interrupts.
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                      << received_event.pin_index << "\t"
+                      << irq_handler.to_ns(received_event.timestamp_ns) << "\n";
         }
     }
 
@@ -0,0 +1,271 @@
+/**
+ * @file CaptureWriter.cpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Implementation of the constant-memory streaming capture writer.
+ * @requirements C++17, Linux (O_DIRECT).
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include "CaptureWriter.hpp"
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+CaptureWriter::CaptureWriter()
+    : m_header_template{}, m_records_per_buffer(0), m_current(nullptr), m_appended(0), m_closing(false), m_fd(-1), m_file_index(0), m_file_records(0), m_direct(false), m_header_block(nullptr), m_dropped(0), m_files(0), m_failed(false), m_open(false) {
+}
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+bool CaptureWriter::open(const Config& config, const CaptureFileHeader& header_template) {
+    if (m_open) {
+        std::cerr << "[CaptureWriter] Already open.\n";
+        return false;
+    }
+
+    if (config.buffer_bytes == 0 || config.buffer_bytes % CAPTURE_HEADER_SIZE != 0 || config.num_buffers < 2) {
+        std::cerr << "\033[31m[CaptureWriter] buffer_bytes must be a multiple of " << CAPTURE_HEADER_SIZE
+                  << " and num_buffers >= 2\033[0m\n";
+        return false;
+    }
+
+    m_config = config;
+    m_header_template = header_template;
+    m_records_per_buffer = config.buffer_bytes / sizeof(GpioIrqEvent);
+
+    // O_DIRECT needs block-aligned memory, offsets and lengths
+    if (posix_memalign(&m_header_block, CAPTURE_HEADER_SIZE, CAPTURE_HEADER_SIZE) != 0) {
+        m_header_block = nullptr;
+        std::cerr << "\033[31m[CaptureWriter] Failed to allocate the header block\033[0m\n";
+        return false;
+    }
+
+    m_buffers.resize(config.num_buffers);
+    for (Buffer& buffer : m_buffers) {
+        void* memory = nullptr;
+        if (posix_memalign(&memory, CAPTURE_HEADER_SIZE, config.buffer_bytes) != 0) {
+            std::cerr << "\033[31m[CaptureWriter] Failed to allocate " << config.buffer_bytes << " byte buffer\033[0m\n";
+            release_buffers();
+            return false;
+        }
+        buffer.records = static_cast<GpioIrqEvent*>(memory);
+        buffer.count = 0;
+        m_free.push_back(&buffer);
+    }
+
+    m_file_index = 0;
+    m_appended = 0;
+    m_dropped.store(0, std::memory_order_relaxed);
+    m_files.store(0, std::memory_order_relaxed);
+    m_failed.store(false, std::memory_order_relaxed);
+
+    // First file is opened here so that path errors surface immediately
+    if (!open_file()) {
+        release_buffers();
+        return false;
+    }
+
+    m_closing = false;
+    m_open = true;
+    m_writer_thread = std::thread(&CaptureWriter::writer_thread_func, this);
+    return true;
+}
+
+void CaptureWriter::close() {
+    if (!m_open) return;
+
+    if (m_current != nullptr) {
+        if (m_current->count > 0) {
+            submit_current();
+        } else {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(m_current);
+            m_current = nullptr;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_cv.notify_one();
+
+    if (m_writer_thread.joinable()) {
+        m_writer_thread.join();
+    }
+
+    release_buffers();
+    m_open = false;
+}
+
+bool CaptureWriter::acquire_buffer() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_free.empty()) return false;
+
+    m_current = m_free.front();
+    m_free.pop_front();
+    m_current->count = 0;
+    return true;
+}
+
+void CaptureWriter::submit_current() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_full.push_back(m_current);
+    }
+    m_cv.notify_one();
+    m_current = nullptr;
+}
+
+void CaptureWriter::writer_thread_func() {
+    for (;;) {
+        Buffer* buffer;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return !m_full.empty() || m_closing; });
+            if (m_full.empty()) break;
+
+            buffer = m_full.front();
+            m_full.pop_front();
+        }
+
+        // After a write error nothing more reaches the disk, but keep
+        // recycling buffers and account for what is lost
+        if (m_failed.load(std::memory_order_relaxed) || !write_buffer(*buffer)) {
+            m_dropped.fetch_add(buffer->count, std::memory_order_relaxed);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        buffer->count = 0;
+        m_free.push_back(buffer);
+    }
+
+    finalize_file();
+}
+
+bool CaptureWriter::write_buffer(Buffer& buffer) {
+    if (m_fd < 0) return false;
+
+    uint64_t file_bytes = CAPTURE_HEADER_SIZE + (m_file_records + buffer.count) * sizeof(GpioIrqEvent);
+    if (m_file_records > 0 && file_bytes > m_config.rotate_bytes) {
+        finalize_file();
+        m_file_index++;
+        if (!open_file()) return false;
+    }
+
+    size_t bytes = buffer.count * sizeof(GpioIrqEvent);
+    size_t write_bytes = bytes;
+
+    // Only the last buffer of a capture is partial: pad it to a whole block
+    // for O_DIRECT, finalize_file() truncates the padding away
+    if (m_direct && bytes % CAPTURE_HEADER_SIZE != 0) {
+        write_bytes = (bytes / CAPTURE_HEADER_SIZE + 1) * CAPTURE_HEADER_SIZE;
+        std::memset(reinterpret_cast<char*>(buffer.records) + bytes, 0, write_bytes - bytes);
+    }
+
+    uint64_t offset = CAPTURE_HEADER_SIZE + m_file_records * sizeof(GpioIrqEvent);
+    if (!write_all(buffer.records, write_bytes, offset)) return false;
+
+    m_file_records += buffer.count;
+    return true;
+}
+
+bool CaptureWriter::open_file() {
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), "_%03u.bin", m_file_index);
+    std::string path = m_config.base_path + suffix;
+
+    m_direct = true;
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (m_fd < 0 && errno == EINVAL) {
+        // tmpfs and some FUSE file systems reject O_DIRECT
+        m_direct = false;
+        m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    if (m_fd < 0) {
+        std::cerr << "\033[31m[CaptureWriter] Failed to open " << path << ": " << std::strerror(errno) << "\033[0m\n";
+        m_failed.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    m_file_records = 0;
+    m_files.fetch_add(1, std::memory_order_relaxed);
+    return write_header();
+}
+
+void CaptureWriter::finalize_file() {
+    if (m_fd < 0) return;
+
+    // Final record count, then drop the O_DIRECT padding of the last block
+    write_header();
+    if (::ftruncate(m_fd, CAPTURE_HEADER_SIZE + m_file_records * sizeof(GpioIrqEvent)) != 0) {
+        std::cerr << "\033[33m[CaptureWriter] Warning: ftruncate failed: " << std::strerror(errno) << "\033[0m\n";
+    }
+    ::fsync(m_fd);
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+bool CaptureWriter::write_header() {
+    CaptureFileHeader header = m_header_template;
+    std::memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_VERSION;
+    header.header_size = CAPTURE_HEADER_SIZE;
+    header.record_size = sizeof(GpioIrqEvent);
+    header.file_index = m_file_index;
+    header.record_count = m_file_records;
+    header.dropped_records = m_dropped.load(std::memory_order_relaxed);
+
+    std::memset(m_header_block, 0, CAPTURE_HEADER_SIZE);
+    std::memcpy(m_header_block, &header, sizeof(header));
+    return write_all(m_header_block, CAPTURE_HEADER_SIZE, 0);
+}
+
+bool CaptureWriter::write_all(const void* data, size_t size, uint64_t offset) {
+    const char* ptr = static_cast<const char*>(data);
+
+    while (size > 0) {
+        ssize_t written = ::pwrite(m_fd, ptr, size, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "\033[31m[CaptureWriter] Write failed: " << std::strerror(errno) << "\033[0m\n";
+            m_failed.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        ptr += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+
+    return true;
+}
+
+void CaptureWriter::release_buffers() {
+    for (Buffer& buffer : m_buffers) {
+        std::free(buffer.records);
+    }
+    m_buffers.clear();
+    m_free.clear();
+    m_full.clear();
+    m_current = nullptr;
+
+    std::free(m_header_block);
+    m_header_block = nullptr;
+
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file CaptureWriter.hpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Constant-memory streaming writer for binary benchmark captures.
+ * @requirements C++17, Linux (O_DIRECT).
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "capture_format.h"
+
+// Records are appended into a fixed pool of block-aligned buffers. Filled
+// buffers are written by a background thread with O_DIRECT (falling back
+// to buffered I/O where unsupported), so the capturing thread never blocks
+// on the disk and memory stays constant however long the run. When no free
+// buffer is left the record is counted as dropped instead of waiting.
+class CaptureWriter {
+public:
+    struct Config {
+        std::string base_path;                 // Files are named <base_path>_NNN.bin
+        uint64_t rotate_bytes = 1ull << 30;    // Start a new file before exceeding this size (min. one buffer per file)
+        size_t buffer_bytes = 1u << 20;        // Multiple of CAPTURE_HEADER_SIZE
+        size_t num_buffers = 8;
+    };
+
+    CaptureWriter();
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    // header_template supplies the clock and pin fields of every file
+    bool open(const Config& config, const CaptureFileHeader& header_template);
+    // Flushes the partial buffer, finalizes the current file, joins the writer
+    void close();
+
+    void append(const GpioIrqEvent& event) {
+        if (m_current == nullptr && !acquire_buffer()) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        m_current->records[m_current->count++] = event;
+        m_appended++;
+        if (m_current->count == m_records_per_buffer) submit_current();
+    }
+
+    uint64_t records_appended() const { return m_appended; }
+    uint64_t records_dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint32_t files_written() const { return m_files.load(std::memory_order_relaxed); }
+    bool write_failed() const { return m_failed.load(std::memory_order_relaxed); }
+
+private:
+    struct Buffer {
+        GpioIrqEvent* records = nullptr;   // CAPTURE_HEADER_SIZE aligned
+        size_t count = 0;
+    };
+
+    Config m_config;
+    CaptureFileHeader m_header_template;
+    std::vector<Buffer> m_buffers;
+    size_t m_records_per_buffer;
+
+    // Producer side
+    Buffer* m_current;
+    uint64_t m_appended;
+
+    // Hand-over between producer and writer, once per buffer
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Buffer*> m_free;
+    std::deque<Buffer*> m_full;
+    bool m_closing;
+
+    // Writer side
+    std::thread m_writer_thread;
+    int m_fd;
+    uint32_t m_file_index;
+    uint64_t m_file_records;
+    bool m_direct;
+    void* m_header_block;
+
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint32_t> m_files;
+    std::atomic<bool> m_failed;
+    bool m_open;
+
+    bool acquire_buffer();
+    void submit_current();
+    void writer_thread_func();
+    bool write_buffer(Buffer& buffer);
+    bool open_file();
+    void finalize_file();
+    bool write_header();
+    bool write_all(const void* data, size_t size, uint64_t offset);
+    void release_buffers();
+};
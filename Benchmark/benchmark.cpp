@@ -15,47 +15,42 @@
 #include <vector>
 #include <atomic>
 #include <csignal>
-#include <thread>
 #include <chrono>
 #include <fstream>
 #include <string>
 #include <iomanip>
 #include <sstream>
+#include <cstdlib>
 #include "RpiFastIrq.hpp"
-
-template <typename T, size_t Size>
-class LockFreeRingBuffer {
-private:
-    T m_data[Size];
-    std::atomic<size_t> m_head{0};
-    std::atomic<size_t> m_tail{0};
-
-public:
-    bool push(const T& item) {
-        size_t current_head = m_head.load(std::memory_order_relaxed);
-        if (current_head - m_tail.load(std::memory_order_acquire) >= Size) {
-            return false;
-        }
-        m_data[current_head % Size] = item;
-        m_head.store(current_head + 1, std::memory_order_release);
-        return true;
-    }
-
-    bool pop(T& item) {
-        size_t current_tail = m_tail.load(std::memory_order_relaxed);
-        if (current_tail == m_head.load(std::memory_order_acquire)) {
-            return false; 
-        }
-        item = m_data[current_tail % Size];
-        m_tail.store(current_tail + 1, std::memory_order_release);
-        return true;
-    }
-};
+#include "JitterStats.hpp"
+#include "SpscQueue.hpp"
+#include "CaptureWriter.hpp"
 
 std::atomic<bool> g_keep_running{true};
 std::atomic<bool> g_capture_active{false};
 std::atomic<uint32_t> g_user_space_drops{0};
-LockFreeRingBuffer<GpioIrqEvent, 1024> g_event_buffer; 
+SpscQueue<GpioIrqEvent, 1024> g_event_buffer;
+// Updated by the listener thread, snapshotted by the main thread
+JitterStats g_jitter_stats;
+
+// Online distribution summary as "# Key: value" footer lines
+void print_distribution(std::ostream& out, const char* name, const DistributionSnapshot& dist) {
+    out << "# " << name << "_Count: " << dist.count << "\n";
+    out << std::fixed << std::setprecision(1);
+    out << "# " << name << "_Mean_ns: " << dist.mean_ns << "\n";
+    out << "# " << name << "_StdDev_ns: " << dist.stddev_ns << "\n";
+    out << "# " << name << "_p50_ns: " << dist.p50_ns << "\n";
+    out << "# " << name << "_p99_ns: " << dist.p99_ns << "\n";
+    out << "# " << name << "_p99.9_ns: " << dist.p999_ns << "\n";
+    out << "# " << name << "_Max_ns: " << dist.max_ns << "\n";
+    out << std::defaultfloat;
+}
+
+void print_jitter_stats(std::ostream& out, const JitterSnapshot& snap) {
+    print_distribution(out, "Online_Delta", snap.deltas);
+    print_distribution(out, "Online_Latency", snap.latency);
+    out << "# Online_Delta_Gaps: " << snap.gaps << "\n";
+}
 
 void print_header() {
     std::cout << R"(
@@ -74,24 +69,55 @@ void print_header() {
 void signal_handler(int signum) {
     (void)signum; 
     g_keep_running = false;
+    // A bare futex syscall, safe in a signal handler
+    g_event_buffer.wake();
 }
 
-std::string get_timestamp_filename() {
+std::string get_timestamp_filename(const char* prefix, const char* extension) {
     auto now = std::chrono::system_clock::now();
     auto in_time_t = std::chrono::system_clock::to_time_t(now);
     std::stringstream ss;
-    ss << "deltaevents_" << std::put_time(std::localtime(&in_time_t), "%H-%M-%S_%d-%m-%Y") << ".dat";
+    ss << prefix << std::put_time(std::localtime(&in_time_t), "%H-%M-%S_%d-%m-%Y") << extension;
     return ss.str();
 }
 
-int main() {
+int main(int argc, char** argv) {
     print_header();
     std::signal(SIGINT, signal_handler);
 
+    // Deltas and counter gaps are only meaningful within a single pin
+    unsigned pin_index = (argc > 1) ? static_cast<unsigned>(std::atoi(argv[1])) : 0;
+    std::cout << "[Config] Benchmarking pin index " << pin_index << std::endl;
+
+    // Optional listener wait mode (poll|spin|hybrid) and CPU to pin it to
+    ListenerConfig listener_config;
+    std::string wait_mode = (argc > 2) ? argv[2] : "poll";
+    if (wait_mode == "spin") listener_config.wait_mode = WaitMode::Spin;
+    else if (wait_mode == "hybrid") listener_config.wait_mode = WaitMode::Hybrid;
+    if (argc > 3) listener_config.cpu = std::atoi(argv[3]);
+    // No page faults on the capture path
+    listener_config.lock_memory = true;
+    listener_config.prefault_stack = 256 << 10;
+    std::cout << "[Config] Listener wait mode: " << wait_mode << ", CPU: " << listener_config.cpu << std::endl;
+
+    // Optional capture format: "text" keeps the deltas in RAM and dumps a
+    // .dat file at exit, "bin" streams raw events to rotated .bin files
+    // (rotation size in MiB) with constant memory
+    std::string capture_format = (argc > 4) ? argv[4] : "text";
+    const bool binary_capture = (capture_format == "bin");
+    uint64_t rotate_mib = (argc > 5) ? std::strtoull(argv[5], nullptr, 10) : 1024;
+    std::cout << "[Config] Capture format: " << capture_format;
+    if (binary_capture) std::cout << ", rotating every " << rotate_mib << " MiB";
+    std::cout << std::endl;
+
     RpiFastIrq irq_handler("/dev/rp1_gpio_irq");
+    irq_handler.subscribe(RpiFastIrq::pin_bit(pin_index));
+    irq_handler.configure(listener_config);
 
-    auto my_irq_callback = [](const GpioIrqEvent& event) {
+    auto my_irq_callback = [&irq_handler](const GpioIrqEvent& event) {
         if (g_capture_active) {
+            // ISR -> callback latency needs the time before the hand-off below
+            g_jitter_stats.on_event(event, irq_handler.clock().now());
             if (!g_event_buffer.push(event)) {
                 g_user_space_drops.fetch_add(1, std::memory_order_relaxed);
             }
@@ -102,21 +128,54 @@ int main() {
         std::cerr << "\033[31m[Error] Could not start IRQ listener.\033[0m" << std::endl;
         return 1;
     }
+    if (irq_handler.capture_engine() == CAPTURE_ENGINE_PIO) {
+        std::cout << "[Config] Capture engine: RP1 PIO, " << irq_handler.timestamp_resolution_ns() << " ns resolution" << std::endl;
+    } else if (irq_handler.capture_engine() == CAPTURE_ENGINE_SYNTH) {
+        std::cout << "[Config] Capture engine: synthetic generator (no GPIO signal needed)" << std::endl;
+    }
 
     std::cout << "\n[Status] Ready. Press ENTER to start benchmark..." << std::endl;
     std::cin.get();
 
-    std::string filename = get_timestamp_filename();
+    std::string filename = get_timestamp_filename("deltaevents_", ".dat");
+
+    CaptureWriter capture_writer;
+    if (binary_capture) {
+        CaptureWriter::Config capture_config;
+        capture_config.base_path = get_timestamp_filename("capture_", "");
+        capture_config.rotate_bytes = rotate_mib << 20;
+
+        CaptureFileHeader header_template{};
+        header_template.pin_index = pin_index;
+        header_template.clock_mode = irq_handler.clock().mode;
+        header_template.counter_freq_hz = irq_handler.clock().freq_hz;
+        header_template.clock_ref_ticks = irq_handler.clock().ref_ticks;
+        header_template.clock_ref_ns = irq_handler.clock().ref_ns;
+        header_template.start_realtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+
+        if (!capture_writer.open(capture_config, header_template)) {
+            irq_handler.stop();
+            return 1;
+        }
+        filename = capture_config.base_path + "_NNN.bin";
+    }
+
     std::cout << "[Running] Capturing... Press Ctrl+C to stop." << std::endl;
+    g_jitter_stats.set_clock(irq_handler.clock());
     g_capture_active = true;
     
     std::vector<uint64_t> deltas;
-    deltas.reserve(1000000); 
+    if (!binary_capture) deltas.reserve(1000000);
+    uint64_t captured = 0;
     
     uint64_t last_timestamp = 0;
     uint32_t dropped_events = 0;
     uint32_t last_counter = 0;
-    GpioIrqEvent event;
+    // The main thread sleeps in the queue until the listener pushes, and
+    // drains whatever accumulated in one go
+    constexpr size_t POP_BATCH = 64;
+    GpioIrqEvent batch[POP_BATCH];
     auto last_ui_update = std::chrono::steady_clock::now();
 
     auto process_event = [&](const GpioIrqEvent& ev) {
@@ -125,45 +184,91 @@ int main() {
         }
         last_counter = ev.event_counter;
 
+        if (binary_capture) {
+            // Raw events go to disk as they are, deltas are left to the analysis
+            capture_writer.append(ev);
+            captured++;
+            return;
+        }
+
+        // Integer deltas in the native clock unit (ns or raw ticks),
+        // converted only when the capture is saved
         if (last_timestamp != 0) {
             deltas.push_back(ev.timestamp_ns - last_timestamp);
+            captured++;
         }
         last_timestamp = ev.timestamp_ns;
     };
 
     while (g_keep_running) {
-        if (g_event_buffer.pop(event)) {
-            process_event(event);
-
-            auto now = std::chrono::steady_clock::now();
-            if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_ui_update).count() >= 250) {
-                std::cout << "\r[Running] Captured: " << deltas.size() 
-                          << " | Kernel Drops: " << dropped_events 
-                          << " | User Drops: " << g_user_space_drops.load(std::memory_order_relaxed) 
-                          << std::flush;
-                last_ui_update = now;
-            }
-        } else {
-            std::this_thread::sleep_for(std::chrono::microseconds(10));
+        // The timeout keeps the status line alive without events
+        size_t count = g_event_buffer.wait_pop_n(batch, POP_BATCH, 250);
+        for (size_t i = 0; i < count; ++i) process_event(batch[i]);
+
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_ui_update).count() >= 250) {
+            JitterSnapshot jitter = g_jitter_stats.snapshot();
+            std::cout << "\r[Running] Captured: " << captured 
+                      << " | Delta p99: " << static_cast<uint64_t>(jitter.deltas.p99_ns) << " ns"
+                      << " | Latency p99: " << static_cast<uint64_t>(jitter.latency.p99_ns) << " ns"
+                      << " | Kernel Drops: " << dropped_events 
+                      << " | User Drops: " << g_user_space_drops.load(std::memory_order_relaxed) 
+                      << " | Ring Overruns: " << irq_handler.ring_stats().kernel_overruns
+                      << (binary_capture ? " | Writer Drops: " : "")
+                      << (binary_capture ? std::to_string(capture_writer.records_dropped()) : "")
+                      << std::flush;
+            last_ui_update = now;
         }
     }
     
     g_capture_active = false;
+    // The header page is unmapped by stop(), read the loss counters first
+    RingStats ring_stats = irq_handler.ring_stats();
     irq_handler.stop();
 
-    while (g_event_buffer.pop(event)) {
-        process_event(event);
+    while (size_t count = g_event_buffer.pop_n(batch, POP_BATCH)) {
+        for (size_t i = 0; i < count; ++i) process_event(batch[i]);
     }
     
     std::cout << "\n\n[System] Saving to " << filename << "..." << std::endl;
+    JitterSnapshot jitter = g_jitter_stats.snapshot();
+
+    if (binary_capture) {
+        capture_writer.close();
+        std::cout << "# Total_Records: " << capture_writer.records_appended() - capture_writer.records_dropped() << "\n";
+        std::cout << "# Files_Written: " << capture_writer.files_written() << "\n";
+        std::cout << "# Writer_Dropped_Records: " << capture_writer.records_dropped() << "\n";
+        std::cout << "# Hardware_Dropped_Events: " << dropped_events << "\n";
+        std::cout << "# UserSpace_Dropped_Events: " << g_user_space_drops.load() << "\n";
+        std::cout << "# Kernel_Ring_Overruns: " << ring_stats.kernel_overruns << "\n";
+        std::cout << "# Ring_High_Water: " << ring_stats.high_water << "/" << ring_stats.capacity << "\n";
+        print_jitter_stats(std::cout, jitter);
+        if (capture_writer.write_failed()) {
+            std::cerr << "\033[31m[Error] The capture is incomplete, see the write errors above.\033[0m" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
     
     std::ofstream outfile(filename);
     if (outfile.is_open()) {
-        for (const auto& d : deltas) outfile << d << "\n";
+        for (const auto& d : deltas) outfile << irq_handler.delta_to_ns(d) << "\n";
         outfile << "# Total_Samples: " << deltas.size() << "\n";
         outfile << "# Hardware_Dropped_Events: " << dropped_events << "\n";
         outfile << "# UserSpace_Dropped_Events: " << g_user_space_drops.load() << "\n";
+        outfile << "# Kernel_Ring_Overruns: " << ring_stats.kernel_overruns << "\n";
+        if (irq_handler.raw_ticks()) {
+            outfile << "# Timestamp_Source: raw ticks @ " << irq_handler.counter_freq_hz() << " Hz\n";
+        }
+        if (irq_handler.capture_engine() == CAPTURE_ENGINE_PIO) {
+            outfile << "# Capture_Engine: PIO @ " << irq_handler.timestamp_resolution_ns() << " ns resolution\n";
+        } else if (irq_handler.capture_engine() == CAPTURE_ENGINE_SYNTH) {
+            outfile << "# Capture_Engine: SYNTH\n";
+        }
+        outfile << "# Ring_High_Water: " << ring_stats.high_water << "/" << ring_stats.capacity << "\n";
+        print_jitter_stats(outfile, jitter);
         outfile.close();
+        print_jitter_stats(std::cout, jitter);
     }
 
     return 0;
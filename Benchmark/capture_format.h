@@ -0,0 +1,50 @@
+/**
+ * @file capture_format.h
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief On-disk layout of the binary benchmark capture (.bin), shared by benchmark.cpp and analyze_jitter.C.
+ * @requirements C++17
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * File layout:
+ *   [0, CAPTURE_HEADER_SIZE)  CaptureFileHeader, zero padded to one block
+ *   [CAPTURE_HEADER_SIZE, ..) GpioIrqEvent records, as read from the ring
+ *
+ * record_count is filled in when the file is closed. A file cut short by a
+ * crash reads record_count == 0: derive the count from the file size, which
+ * always holds whole records.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// GpioIrqEvent, CLOCK_MODE_* (relative path: also included by the ROOT macro)
+#include "../kernel_module/rpi_fast_irq_uapi.h"
+
+#define CAPTURE_MAGIC       "RPIFIRQC"
+#define CAPTURE_VERSION     1
+#define CAPTURE_HEADER_SIZE 4096   // One O_DIRECT block: records stay block aligned
+
+struct CaptureFileHeader {
+    char magic[8];              // CAPTURE_MAGIC, not null terminated
+    uint32_t version;           // CAPTURE_VERSION
+    uint32_t header_size;       // Byte offset of the first record
+    uint32_t record_size;       // sizeof(GpioIrqEvent)
+    uint32_t pin_index;         // Pin the capture was filtered on
+    uint32_t clock_mode;        // CLOCK_MODE_* of timestamp_ns
+    uint32_t file_index;        // Position in a rotated sequence, from 0
+    uint64_t counter_freq_hz;   // Clock parameters of the ring (see SharedRingMeta)
+    uint64_t clock_ref_ticks;
+    uint64_t clock_ref_ns;
+    uint64_t start_realtime_ns; // Wall clock when the capture started
+    uint64_t record_count;      // Records in this file, 0 until the file is closed
+    uint64_t dropped_records;   // Records lost so far because the writer fell behind
+};
+
+static_assert(sizeof(CaptureFileHeader) <= CAPTURE_HEADER_SIZE, "capture header exceeds its block");
+static_assert(CAPTURE_HEADER_SIZE % sizeof(GpioIrqEvent) == 0, "records must not straddle blocks");
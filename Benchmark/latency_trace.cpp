@@ -0,0 +1,122 @@
+/**
+ * @file latency_trace.cpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief End-to-end latency breakdown: ISR entry -> wakeup -> ISR exit -> listener -> callback.
+ * Requirements: RpiFastIrq library, rpi_fast_irq kernel module loaded with trace_latency=1.
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <csignal>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include "RpiFastIrq.hpp"
+#include "JitterStats.hpp"
+
+std::atomic<bool> g_keep_running{true};
+
+// One distribution per stage, updated by the listener thread only
+enum Stage {
+    STAGE_ISR_TO_WAKEUP,      // Ring write inside the ISR
+    STAGE_WAKEUP_TO_EXIT,     // wake_up_interruptible() cost
+    STAGE_WAKEUP_TO_LISTENER, // Scheduler: wakeup until poll() returned
+    STAGE_LISTENER_TO_CALLBACK,
+    STAGE_END_TO_END,         // ISR entry until callback, every event
+    STAGE_COUNT
+};
+
+const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "ISR entry -> wakeup",
+    "wakeup -> ISR exit",
+    "wakeup -> listener",
+    "listener -> callback",
+    "ISR entry -> callback",
+};
+
+DistributionTracker g_stages[STAGE_COUNT];
+std::atomic<uint64_t> g_incomplete{0};
+
+void signal_handler(int signum) {
+    (void)signum;
+    g_keep_running = false;
+}
+
+inline void record_stage(Stage stage, uint64_t from, uint64_t to) {
+    if (from != 0 && to >= from) g_stages[stage].record(to - from);
+}
+
+void print_stages() {
+    const RingClock ns_clock;
+    std::cout << std::left << std::setw(24) << "Stage" << std::right
+              << std::setw(10) << "count" << std::setw(11) << "mean" << std::setw(11) << "p50"
+              << std::setw(11) << "p99" << std::setw(11) << "p99.9" << std::setw(11) << "max" << "  (ns)\n";
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        DistributionSnapshot s = g_stages[i].snapshot(ns_clock);
+        std::cout << std::left << std::setw(24) << STAGE_NAMES[i] << std::right << std::fixed << std::setprecision(0)
+                  << std::setw(10) << s.count << std::setw(11) << s.mean_ns << std::setw(11) << s.p50_ns
+                  << std::setw(11) << s.p99_ns << std::setw(11) << s.p999_ns << std::setw(11) << s.max_ns << "\n";
+    }
+    std::cout << std::defaultfloat << "Incomplete ISR records: " << g_incomplete.load(std::memory_order_relaxed) << "\n";
+}
+
+int main(int argc, char** argv) {
+    std::signal(SIGINT, signal_handler);
+
+    // Same arguments as benchmark.x: [pin] [poll|spin|hybrid] [cpu]
+    unsigned pin_index = (argc > 1) ? static_cast<unsigned>(std::atoi(argv[1])) : 0;
+    ListenerConfig listener_config;
+    std::string wait_mode = (argc > 2) ? argv[2] : "poll";
+    if (wait_mode == "spin") listener_config.wait_mode = WaitMode::Spin;
+    else if (wait_mode == "hybrid") listener_config.wait_mode = WaitMode::Hybrid;
+    if (argc > 3) listener_config.cpu = std::atoi(argv[3]);
+    // No page faults on the capture path
+    listener_config.lock_memory = true;
+    listener_config.prefault_stack = 256 << 10;
+    std::cout << "[Config] Pin index " << pin_index << ", listener wait mode: " << wait_mode
+              << ", CPU: " << listener_config.cpu << std::endl;
+
+    RpiFastIrq irq_handler("/dev/rp1_gpio_irq");
+    irq_handler.subscribe(RpiFastIrq::pin_bit(pin_index));
+    irq_handler.configure(listener_config);
+
+    auto trace_callback = [](const GpioIrqEvent& event, const LatencyTrace& trace) {
+        (void)event;
+        record_stage(STAGE_END_TO_END, trace.isr_entry_ns, trace.callback_ns);
+        record_stage(STAGE_LISTENER_TO_CALLBACK, trace.poll_return_ns, trace.callback_ns);
+        if (!trace.kernel_valid) {
+            g_incomplete.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        record_stage(STAGE_ISR_TO_WAKEUP, trace.isr_entry_ns, trace.wakeup_ns);
+        record_stage(STAGE_WAKEUP_TO_EXIT, trace.wakeup_ns, trace.isr_exit_ns);
+        record_stage(STAGE_WAKEUP_TO_LISTENER, trace.wakeup_ns, trace.poll_return_ns);
+    };
+
+    if (!irq_handler.start_traced(trace_callback)) {
+        std::cerr << "\033[31m[Error] Could not start the traced IRQ listener.\033[0m" << std::endl;
+        return 1;
+    }
+
+    std::cout << "[Running] Tracing... Press Ctrl+C to stop." << std::endl;
+    while (g_keep_running) {
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        if (!g_keep_running) break;
+        std::cout << "\n";
+        print_stages();
+    }
+
+    irq_handler.stop();
+
+    std::cout << "\n[Final]\n";
+    print_stages();
+    return 0;
+}
@@ -0,0 +1,402 @@
+/**
+ * @file sweep.cpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Non-interactive saturation sweep: steps the synthetic generator through a list of rates and reports throughput, losses, listener CPU and latency percentiles per rate as JSON or CSV.
+ * Requirements: RpiFastIrq library, rpi_fast_irq kernel module loaded with capture_engine=2.
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <csignal>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <pthread.h>
+#include "RpiFastIrq.hpp"
+#include "JitterStats.hpp"
+#include "SpscQueue.hpp"
+
+std::atomic<bool> g_keep_running{true};
+
+// Listener-side state of one rate step. The listener only writes through
+// the pointer published in g_step, the main thread reads the counters and
+// the snapshot at any time.
+struct StepState {
+    JitterStats jitter;
+    std::atomic<uint64_t> received{0};       // Callbacks in the window
+    std::atomic<uint64_t> lost{0};           // Events missing from event_counter before the listener
+    std::atomic<uint64_t> user_drops{0};     // Hand-off queue full
+    uint32_t last_counter = 0;
+    bool have_last = false;
+};
+
+std::atomic<StepState*> g_step{nullptr};
+// Set by the listener around every use of g_step: after the main thread
+// clears g_step and sees this false, no callback holds the old pointer.
+// Both sides use seq_cst so the flag store and the pointer load cannot be
+// reordered (store-load handshake).
+std::atomic<bool> g_in_callback{false};
+std::atomic<bool> g_listener_known{false};
+pthread_t g_listener_thread;
+SpscQueue<GpioIrqEvent, 1024> g_event_buffer;
+
+// Result of one rate step
+struct StepResult {
+    uint32_t rate_hz = 0;
+    double elapsed_s = 0;
+    uint64_t received = 0;
+    uint64_t consumed = 0;
+    uint64_t lost = 0;
+    uint64_t user_drops = 0;
+    uint64_t kernel_overruns = 0;
+    uint64_t reader_skipped = 0;
+    uint64_t synth_missed = 0;
+    uint32_t high_water = 0;
+    double throughput_hz = 0;
+    double listener_cpu_pct = -1;   // -1 = unknown (no event reached the listener)
+    DistributionSnapshot latency;
+    uint64_t gaps = 0;
+    bool sustained = false;
+};
+
+void signal_handler(int signum) {
+    (void)signum;
+    g_keep_running = false;
+    g_event_buffer.wake();
+}
+
+void print_usage() {
+    std::cout << "Usage: sweep.x <rates> [limit] [json|csv] [output|-] [periodic|poisson|burst] [pin] [poll|spin|hybrid] [cpu]\n"
+              << "  rates   Comma list (1000,10000,100000) or log range start:stop:steps (1000:1000000:7)\n"
+              << "  limit   Per-rate window: <seconds>s (default 5s) or <events>ev\n"
+              << "  output  File name, - for stdout (default sweep_<time>.<format>)\n";
+}
+
+// "1000,5000" or "1000:1000000:7" (log-spaced, both ends included)
+bool parse_rates(const std::string& spec, std::vector<uint32_t>& rates) {
+    if (spec.find(':') != std::string::npos) {
+        unsigned long start = 0, stop = 0, steps = 0;
+        if (std::sscanf(spec.c_str(), "%lu:%lu:%lu", &start, &stop, &steps) != 3 || start == 0 || stop < start || steps == 0) return false;
+        for (unsigned long i = 0; i < steps; ++i) {
+            double t = (steps == 1) ? 0.0 : static_cast<double>(i) / static_cast<double>(steps - 1);
+            double rate = static_cast<double>(start) * std::pow(static_cast<double>(stop) / static_cast<double>(start), t);
+            rates.push_back(static_cast<uint32_t>(std::llround(rate)));
+        }
+    } else {
+        std::stringstream ss(spec);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            unsigned long rate = std::strtoul(item.c_str(), nullptr, 0);
+            if (rate == 0) return false;
+            rates.push_back(static_cast<uint32_t>(rate));
+        }
+    }
+    for (uint32_t rate : rates) {
+        if (rate == 0 || rate > SYNTH_RATE_MAX) return false;
+    }
+    return !rates.empty();
+}
+
+// CPU time consumed by the listener thread so far, -1 when not known yet
+double listener_cpu_seconds() {
+    if (!g_listener_known.load(std::memory_order_acquire)) return -1;
+    clockid_t clock_id;
+    struct timespec ts;
+    if (pthread_getcpuclockid(g_listener_thread, &clock_id) != 0 || clock_gettime(clock_id, &ts) != 0) return -1;
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+// Pops whatever the listener handed off; the queue is only drained, the
+// consumer side exists so that user drops are measured on the same
+// pipeline as benchmark.x
+uint64_t drain_queue(int timeout_ms) {
+    constexpr size_t POP_BATCH = 64;
+    GpioIrqEvent batch[POP_BATCH];
+    return timeout_ms > 0 ? g_event_buffer.wait_pop_n(batch, POP_BATCH, timeout_ms) : g_event_buffer.pop_n(batch, POP_BATCH);
+}
+
+StepResult run_step(RpiFastIrq& irq, RpiFastIrqSynth synth, uint32_t rate_hz, double duration_s, uint64_t target_events) {
+    StepResult result;
+    result.rate_hz = rate_hz;
+
+    synth.rate_hz = rate_hz;
+    if (!irq.set_synth(synth)) {
+        g_keep_running = false;
+        return result;
+    }
+
+    // Let the generator and the listener settle, then discard the backlog
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    while (drain_queue(0)) {}
+
+    auto step = std::make_unique<StepState>();
+    step->jitter.set_clock(irq.clock());
+
+    // Zeroes the ring high water so that it is reported per rate
+    irq.reset_counters();
+    RingStats stats_before = irq.ring_stats();
+    RpiFastIrqSynth synth_before{};
+    irq.get_synth(synth_before);
+    double cpu_before = listener_cpu_seconds();
+    auto t_start = std::chrono::steady_clock::now();
+    g_step.store(step.get(), std::memory_order_release);
+
+    // In count mode the window is capped at ten times the expected length
+    const double limit_s = target_events ? 10.0 * static_cast<double>(target_events) / rate_hz + 1.0 : duration_s;
+    auto deadline = t_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(limit_s));
+    while (g_keep_running && std::chrono::steady_clock::now() < deadline) {
+        result.consumed += drain_queue(50);
+        if (target_events && step->received.load(std::memory_order_relaxed) >= target_events) break;
+    }
+
+    g_step.store(nullptr);
+    auto t_end = std::chrono::steady_clock::now();
+    double cpu_after = listener_cpu_seconds();
+    RingStats stats_after = irq.ring_stats();
+    RpiFastIrqSynth synth_after{};
+    irq.get_synth(synth_after);
+
+    // The events handed off before the window closed still count
+    while (uint64_t count = drain_queue(0)) result.consumed += count;
+
+    // Wait until the listener has left a callback that loaded the old
+    // pointer; later callbacks see nullptr
+    while (g_in_callback.load()) std::this_thread::yield();
+    result.elapsed_s = std::chrono::duration<double>(t_end - t_start).count();
+    result.received = step->received.load();
+    result.lost = step->lost.load();
+    result.user_drops = step->user_drops.load();
+    result.kernel_overruns = stats_after.kernel_overruns - stats_before.kernel_overruns;
+    result.reader_skipped = stats_after.reader_skipped - stats_before.reader_skipped;
+    result.synth_missed = synth_after.missed - synth_before.missed;
+    result.high_water = stats_after.high_water;
+    result.throughput_hz = result.elapsed_s > 0 ? static_cast<double>(result.consumed) / result.elapsed_s : 0;
+    if (cpu_before >= 0 && cpu_after >= 0 && result.elapsed_s > 0) {
+        result.listener_cpu_pct = 100.0 * (cpu_after - cpu_before) / result.elapsed_s;
+    }
+    JitterSnapshot jitter = step->jitter.snapshot();
+    result.latency = jitter.latency;
+    result.gaps = jitter.gaps;
+
+    // Sustained: nothing lost anywhere and at least 99% of the requested
+    // rate made it to the consumer. Poisson windows fluctuate by
+    // sqrt(N), which is well inside the margin for windows of 10^4 events.
+    result.sustained = result.lost == 0 && result.user_drops == 0 && result.kernel_overruns == 0 &&
+                       result.reader_skipped == 0 && result.synth_missed == 0 &&
+                       result.throughput_hz >= 0.99 * static_cast<double>(rate_hz);
+    return result;
+}
+
+void write_csv(std::ostream& out, const std::vector<StepResult>& results) {
+    out << "rate_hz,elapsed_s,received,consumed,throughput_hz,lost,user_drops,kernel_overruns,reader_skipped,"
+        << "synth_missed,high_water,listener_cpu_pct,latency_count,latency_mean_ns,latency_p50_ns,latency_p99_ns,"
+        << "latency_p999_ns,latency_max_ns,sustained\n";
+    out << std::fixed << std::setprecision(1);
+    for (const StepResult& r : results) {
+        out << r.rate_hz << "," << std::setprecision(3) << r.elapsed_s << std::setprecision(1) << ","
+            << r.received << "," << r.consumed << "," << r.throughput_hz << "," << r.lost << "," << r.user_drops << ","
+            << r.kernel_overruns << "," << r.reader_skipped << "," << r.synth_missed << "," << r.high_water << ","
+            << r.listener_cpu_pct << "," << r.latency.count << "," << r.latency.mean_ns << "," << r.latency.p50_ns << ","
+            << r.latency.p99_ns << "," << r.latency.p999_ns << "," << r.latency.max_ns << "," << (r.sustained ? 1 : 0) << "\n";
+    }
+    out << std::defaultfloat;
+}
+
+void write_json(std::ostream& out, const RpiFastIrqInfo& info, const RpiFastIrq& irq, const std::string& pattern,
+                const std::string& wait_mode, int cpu, const std::string& limit, const std::vector<StepResult>& results) {
+    uint32_t max_sustained = 0;
+    for (const StepResult& r : results) {
+        if (r.sustained && r.rate_hz > max_sustained) max_sustained = r.rate_hz;
+    }
+    auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::stringstream date;
+    date << std::put_time(std::gmtime(&now), "%Y-%m-%dT%H:%M:%SZ");
+
+    out << std::fixed << std::setprecision(1);
+    out << "{\n"
+        << "  \"date\": \"" << date.str() << "\",\n"
+        << "  \"driver_version\": \"" << (info.driver_version >> 16) << "." << (info.driver_version & 0xFFFF) << "\",\n"
+        << "  \"layout_version\": " << info.layout_version << ",\n"
+        << "  \"ring_capacity\": " << info.capacity << ",\n"
+        << "  \"event_format\": " << info.event_format << ",\n"
+        << "  \"raw_ticks\": " << (irq.raw_ticks() ? "true" : "false") << ",\n"
+        << "  \"irq_cpu\": " << info.irq_cpu << ",\n"
+        << "  \"listener_cpu\": " << cpu << ",\n"
+        << "  \"wait_mode\": \"" << wait_mode << "\",\n"
+        << "  \"pattern\": \"" << pattern << "\",\n"
+        << "  \"limit\": \"" << limit << "\",\n"
+        << "  \"max_sustained_hz\": " << max_sustained << ",\n"
+        << "  \"steps\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const StepResult& r = results[i];
+        out << "    {\"rate_hz\": " << r.rate_hz << ", \"elapsed_s\": " << std::setprecision(3) << r.elapsed_s << std::setprecision(1)
+            << ", \"received\": " << r.received << ", \"consumed\": " << r.consumed << ", \"throughput_hz\": " << r.throughput_hz
+            << ", \"lost\": " << r.lost << ", \"user_drops\": " << r.user_drops << ", \"kernel_overruns\": " << r.kernel_overruns
+            << ", \"reader_skipped\": " << r.reader_skipped << ", \"synth_missed\": " << r.synth_missed
+            << ", \"high_water\": " << r.high_water << ", \"listener_cpu_pct\": " << r.listener_cpu_pct
+            << ", \"latency_ns\": {\"count\": " << r.latency.count << ", \"mean\": " << r.latency.mean_ns
+            << ", \"p50\": " << r.latency.p50_ns << ", \"p99\": " << r.latency.p99_ns << ", \"p999\": " << r.latency.p999_ns
+            << ", \"max\": " << r.latency.max_ns << "}, \"sustained\": " << (r.sustained ? "true" : "false") << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n" << std::defaultfloat;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    std::signal(SIGINT, signal_handler);
+
+    std::vector<uint32_t> rates;
+    if (!parse_rates(argv[1], rates)) {
+        std::cerr << "\033[31m[Error] Invalid rate list: " << argv[1] << " (1.." << SYNTH_RATE_MAX << " Hz)\033[0m" << std::endl;
+        return 1;
+    }
+
+    std::string limit = (argc > 2) ? argv[2] : "5s";
+    double duration_s = 0;
+    uint64_t target_events = 0;
+    if (limit.size() > 2 && limit.compare(limit.size() - 2, 2, "ev") == 0) {
+        target_events = std::strtoull(limit.c_str(), nullptr, 10);
+    } else if (limit.size() > 1 && limit.back() == 's') {
+        duration_s = std::strtod(limit.c_str(), nullptr);
+    }
+    if (target_events == 0 && duration_s <= 0) {
+        print_usage();
+        return 1;
+    }
+
+    std::string format = (argc > 3) ? argv[3] : "json";
+    if (format != "json" && format != "csv") {
+        print_usage();
+        return 1;
+    }
+
+    std::string output;
+    if (argc > 4) {
+        output = argv[4];
+    } else {
+        auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::stringstream ss;
+        ss << "sweep_" << std::put_time(std::localtime(&now), "%H-%M-%S_%d-%m-%Y") << "." << format;
+        output = ss.str();
+    }
+
+    std::string pattern = (argc > 5) ? argv[5] : "periodic";
+    int pattern_value = (pattern == "periodic") ? SYNTH_PATTERN_PERIODIC : (pattern == "poisson") ? SYNTH_PATTERN_POISSON : (pattern == "burst") ? SYNTH_PATTERN_BURST : -1;
+    if (pattern_value < 0) {
+        print_usage();
+        return 1;
+    }
+
+    // Same listener arguments as benchmark.x: [pin] [poll|spin|hybrid] [cpu]
+    unsigned pin_index = (argc > 6) ? static_cast<unsigned>(std::atoi(argv[6])) : 0;
+    ListenerConfig listener_config;
+    std::string wait_mode = (argc > 7) ? argv[7] : "poll";
+    if (wait_mode == "spin") listener_config.wait_mode = WaitMode::Spin;
+    else if (wait_mode == "hybrid") listener_config.wait_mode = WaitMode::Hybrid;
+    if (argc > 8) listener_config.cpu = std::atoi(argv[8]);
+    listener_config.lock_memory = true;
+    listener_config.prefault_stack = 256 << 10;
+
+    RpiFastIrq irq("/dev/rp1_gpio_irq");
+    irq.subscribe(RpiFastIrq::pin_bit(pin_index));
+    irq.configure(listener_config);
+
+    RpiFastIrqInfo info{};
+    RpiFastIrqSynth initial_synth{};
+    if (!irq.query_info(info)) return 1;
+    if (!(info.flags & INFO_FLAG_SYNTH) || !irq.get_synth(initial_synth)) {
+        std::cerr << "\033[31m[Error] The sweep needs the synthetic generator: load the module with capture_engine=2.\033[0m" << std::endl;
+        return 1;
+    }
+    if (pin_index >= info.num_pins) {
+        std::cerr << "\033[31m[Error] Pin index " << pin_index << " out of range (" << info.num_pins << " pins).\033[0m" << std::endl;
+        return 1;
+    }
+
+    auto callback = [&irq](const GpioIrqEvent& event) {
+        if (!g_listener_known.load(std::memory_order_relaxed)) {
+            g_listener_thread = pthread_self();
+            g_listener_known.store(true, std::memory_order_release);
+        }
+        g_in_callback.store(true);
+        StepState* step = g_step.load();
+        if (!step) {
+            g_in_callback.store(false, std::memory_order_release);
+            return;
+        }
+
+        if (step->have_last && event.event_counter != step->last_counter + 1) {
+            step->lost.fetch_add(event.event_counter - step->last_counter - 1, std::memory_order_relaxed);
+        }
+        step->last_counter = event.event_counter;
+        step->have_last = true;
+        step->received.fetch_add(1, std::memory_order_relaxed);
+
+        step->jitter.on_event(event, irq.clock().now());
+        if (!g_event_buffer.push(event)) step->user_drops.fetch_add(1, std::memory_order_relaxed);
+        g_in_callback.store(false, std::memory_order_release);
+    };
+
+    if (!irq.start(callback)) {
+        std::cerr << "\033[31m[Error] Could not start IRQ listener.\033[0m" << std::endl;
+        return 1;
+    }
+
+    RpiFastIrqSynth synth = initial_synth;
+    synth.pattern = static_cast<uint32_t>(pattern_value);
+    synth.pin_mask |= RpiFastIrq::pin_bit(pin_index);
+
+    std::cerr << "[Sweep] " << rates.size() << " rates, " << pattern << ", " << limit << " per rate, pin " << pin_index
+              << ", " << wait_mode << " listener on CPU " << listener_config.cpu << std::endl;
+    std::vector<StepResult> results;
+    for (uint32_t rate : rates) {
+        if (!g_keep_running) break;
+        StepResult result = run_step(irq, synth, rate, duration_s, target_events);
+        if (!g_keep_running && result.elapsed_s == 0) break;
+        results.push_back(result);
+        std::cerr << "[Sweep] " << std::setw(8) << rate << " Hz: " << std::fixed << std::setprecision(0)
+                  << result.throughput_hz << " ev/s, lost " << result.lost << ", user drops " << result.user_drops
+                  << ", overruns " << result.kernel_overruns << ", missed " << result.synth_missed
+                  << ", p99 " << result.latency.p99_ns << " ns, CPU " << std::setprecision(1) << result.listener_cpu_pct << "%"
+                  << (result.sustained ? "" : "  [saturated]") << std::defaultfloat << std::endl;
+    }
+
+    irq.set_synth(initial_synth);
+    irq.stop();
+
+    std::ofstream file;
+    if (output != "-") {
+        file.open(output);
+        if (!file.is_open()) {
+            std::cerr << "\033[31m[Error] Could not create " << output << ".\033[0m" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = (output == "-") ? std::cout : file;
+    if (format == "csv") {
+        write_csv(out, results);
+    } else {
+        write_json(out, info, irq, pattern, wait_mode, listener_config.cpu, limit, results);
+    }
+    if (output != "-") std::cerr << "[Sweep] Results written to " << output << std::endl;
+    return 0;
+}
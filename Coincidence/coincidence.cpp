@@ -0,0 +1,136 @@
+/**
+ * @file coincidence.cpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Live coincidence finder: merges the pin streams, applies the coincidence window and vetoes, and writes only the accepted groups.
+ * @requirements RpiFastIrq library, kernel module loaded with two or more pins, write access to /dev/rp1_gpio_irq.
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <iostream>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <csignal>
+#include <string>
+#include <cstdlib>
+#include <poll.h>
+#include "RpiFastIrq.hpp"
+#include "CoincidenceEngine.hpp"
+
+std::atomic<bool> g_keep_running{true};
+
+void signal_handler(int signum) {
+    (void)signum;
+    g_keep_running.store(false, std::memory_order_release);
+}
+
+void print_usage() {
+    std::cout << "Usage: coincidence.x <window_ns> [min_pins] [require_mask] [veto_mask] [veto_ns] [max_skew_ns] [output|-]\n"
+              << "  Masks are pin_index bits (hex or decimal). Every pin that is not a veto pin takes part.\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    std::signal(SIGINT, signal_handler);
+
+    CoincidenceConfig config;
+    config.window_ns = std::strtoull(argv[1], nullptr, 10);
+    if (argc > 2) config.min_pins = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+    if (argc > 3) config.require_mask = static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 0));
+    if (argc > 4) config.veto_mask = static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 0));
+    if (argc > 5) config.veto_ns = std::strtoull(argv[5], nullptr, 10);
+    if (argc > 6) config.max_skew_ns = std::strtoull(argv[6], nullptr, 10);
+    std::string output = (argc > 7) ? argv[7] : "";
+
+    // Threadless: the merge, the groups and the file all live on this
+    // thread, and the poll() timeout lets time pass for the open groups
+    RpiFastIrq irq_handler("/dev/rp1_gpio_irq");
+    if (!irq_handler.open()) return 1;
+
+    RpiFastIrqInfo info{};
+    if (!irq_handler.query_info(info)) return 1;
+    const uint32_t existing = (info.num_pins >= 32) ? RpiFastIrq::ALL_PINS : (RpiFastIrq::pin_bit(info.num_pins) - 1);
+    config.veto_mask &= existing;
+    config.input_mask = existing & ~config.veto_mask;
+
+    if (output.empty()) {
+        auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::stringstream ss;
+        ss << "coincidences_" << std::put_time(std::localtime(&now), "%H-%M-%S_%d-%m-%Y") << ".dat";
+        output = ss.str();
+    }
+    std::ofstream file;
+    if (output != "-") {
+        file.open(output);
+        if (!file.is_open()) {
+            std::cerr << "\033[31m[Error] Could not create " << output << ".\033[0m" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = (output == "-") ? std::cout : file;
+
+    const RingClock& clock = irq_handler.clock();
+    out << "# Window_ns: " << config.window_ns << "\n"
+        << "# Min_Pins: " << config.min_pins << "\n"
+        << "# Require_Mask: 0x" << std::hex << config.require_mask << "\n"
+        << "# Veto_Mask: 0x" << config.veto_mask << std::dec << "\n"
+        << "# Veto_ns: " << config.veto_ns << "\n"
+        << "# Columns: first_timestamp_ns pin_mask events span_ns\n";
+
+    // One line per accepted group; nothing is written for the rest
+    CoincidenceEngine engine(config, [&](const CoincidenceGroup& group) {
+        out << clock.to_ns(group.first_timestamp) << " 0x" << std::hex << group.pin_mask << std::dec << " "
+            << group.count << (group.truncated ? "+" : "") << " "
+            << clock.delta_to_ns(group.last_timestamp - group.first_timestamp) << "\n";
+    });
+    engine.set_clock(clock);
+
+    std::cerr << "[Coincidence] " << info.num_pins << " pins, inputs 0x" << std::hex << config.input_mask
+              << ", vetoes 0x" << config.veto_mask << std::dec << ", window " << config.window_ns << " ns. Ctrl+C to stop.\n";
+
+    struct pollfd pfd = {irq_handler.fd(), POLLIN, 0};
+    auto last_ui_update = std::chrono::steady_clock::now();
+    while (g_keep_running.load(std::memory_order_acquire)) {
+        // A short timeout bounds how long a finished group waits for the
+        // next event before it is decided. The time is taken before the
+        // drain, so every event stamped earlier has been pushed when it is
+        // passed to advance().
+        const uint64_t before_drain = clock.now();
+        if (::poll(&pfd, 1, 10) > 0) irq_handler.drain([&engine](const GpioIrqEvent& e) { engine.push(e); });
+        engine.advance(before_drain);
+
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_ui_update).count() >= 1000) {
+            const CoincidenceStats& stats = engine.stats();
+            std::cerr << "\r[Coincidence] Events: " << stats.events_in << " | Groups: " << stats.groups
+                      << " | Accepted: " << stats.emitted << " | Vetoed: " << stats.vetoed
+                      << " | Late: " << stats.late_events << " | Ring Overruns: " << irq_handler.ring_stats().kernel_overruns
+                      << std::flush;
+            last_ui_update = now;
+        }
+    }
+
+    engine.flush();
+    const CoincidenceStats& stats = engine.stats();
+    out << "# Events_In: " << stats.events_in << "\n"
+        << "# Groups: " << stats.groups << "\n"
+        << "# Accepted_Groups: " << stats.emitted << "\n"
+        << "# Vetoed_Groups: " << stats.vetoed << "\n"
+        << "# Rejected_Groups: " << stats.too_few_pins << "\n"
+        << "# Late_Events: " << stats.late_events << "\n"
+        << "# Forced_Releases: " << stats.forced_releases << "\n"
+        << "# Reader_Skipped: " << irq_handler.ring_stats().reader_skipped << "\n";
+    irq_handler.close();
+    std::cerr << "\n[Coincidence] " << stats.emitted << " groups written to " << (output == "-" ? "stdout" : output) << std::endl;
+    return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file irqctl.cpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Command-line front end of the rpi_fast_irq control ioctls: reconfigure without reloading.
+ * @requirements RpiFastIrq library, kernel module loaded, write access to /dev/rp1_gpio_irq.
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include "RpiFastIrq.hpp"
+
+void print_usage() {
+    std::cout << "Usage: irqctl.x <command> [args]\n"
+              << "  info                          Module version, ring and pin state\n"
+              << "  reset-counters                Zero overruns, high water and filtered counts\n"
+              << "  enable <mask>                 Enable the pin IRQs in mask (hex or decimal), disable the rest\n"
+              << "  irq-cpu <cpu>                 Bind the pin IRQs to cpu (-1 = drop the binding)\n"
+              << "  edge <pin> rising|falling|both\n"
+              << "  filter <pin> <deadtime_ns> <prescale>\n"
+              << "  ring <size> [gpio ...]        Rebuild the ring (size 0 = same), optionally with new GPIOs\n"
+              << "  synth periodic|poisson|burst <rate_hz> [pin_mask] [burst_len] [gap_us]\n"
+              << "                                Reprogram the synthetic generator (capture_engine=2)\n";
+}
+
+bool print_info(const RpiFastIrq& irq) {
+    RpiFastIrqInfo info{};
+    if (!irq.query_info(info)) return false;
+
+    std::cout << "Driver version : " << (info.driver_version >> 16) << "." << (info.driver_version & 0xFFFF) << "\n"
+              << "Layout version : " << info.layout_version << " (library " << RING_LAYOUT_VERSION << ")\n"
+              << "Ring capacity  : " << info.capacity << " events, format " << info.event_format
+              << ((info.flags & INFO_FLAG_CONTIGUOUS) ? ", contiguous" : "") << "\n"
+              << "Timestamps     : " << ((info.flags & INFO_FLAG_RAW_TICKS) ? "raw ticks" : "ns")
+              << ((info.flags & INFO_FLAG_TRACE) ? ", latency tracing on" : "") << "\n"
+              << "Capture engine : " << ((info.flags & INFO_FLAG_PIO) ? "RP1 PIO (hardware timestamps)"
+                                      : (info.flags & INFO_FLAG_SYNTH) ? "Synthetic generator" : "GPIO IRQ") << "\n"
+              << "Clock sync     : " << ((info.flags & INFO_FLAG_CLOCK_SYNC) ? "CLOCK_TAI pairs (sync_period_ms)" : "off") << "\n"
+              << "IRQ CPU        : " << info.irq_cpu << "\n";
+
+    RpiFastIrqSynth synth{};
+    if ((info.flags & INFO_FLAG_SYNTH) && irq.get_synth(synth)) {
+        static const char* const patterns[] = {"periodic", "poisson", "burst"};
+        std::cout << "Synth schedule : " << (synth.pattern <= SYNTH_PATTERN_BURST ? patterns[synth.pattern] : "?")
+                  << " " << synth.rate_hz << " Hz, pin mask 0x" << std::hex << synth.pin_mask << std::dec;
+        if (synth.pattern == SYNTH_PATTERN_BURST) {
+            std::cout << ", " << synth.burst_len << " per burst, gap " << synth.burst_gap_us << " us";
+        }
+        std::cout << ", " << synth.missed << " missed ticks\n";
+    }
+
+    for (uint32_t i = 0; i < info.num_pins && i < MAX_PINS; ++i) {
+        RpiFastIrqFilter filter{};
+        std::cout << "Pin " << i << ": GPIO " << info.pins[i] << ", "
+                  << ((info.enabled_mask & RpiFastIrq::pin_bit(i)) ? "enabled" : "disabled");
+        if (irq.get_filter(i, filter)) {
+            static const char* const edges[] = {"rising", "falling", "both"};
+            std::cout << ", edge " << (filter.edge <= FILTER_EDGE_BOTH ? edges[filter.edge] : "?")
+                      << ", deadtime " << filter.deadtime_ns << " ns, prescale " << filter.prescale;
+        }
+        std::cout << "\n";
+    }
+    return true;
+}
+
+// Read-modify-write of one pin's filter
+bool update_filter(RpiFastIrq& irq, uint32_t pin, int edge, int64_t deadtime_ns, int64_t prescale) {
+    RpiFastIrqFilter filter{};
+    if (!irq.get_filter(pin, filter)) return false;
+
+    filter.pin_index = pin;
+    if (edge >= 0) filter.edge = static_cast<uint32_t>(edge);
+    if (deadtime_ns >= 0) filter.deadtime_ns = static_cast<uint64_t>(deadtime_ns);
+    if (prescale >= 0) filter.prescale = static_cast<uint32_t>(prescale);
+    return irq.set_filter(filter);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    RpiFastIrq irq("/dev/rp1_gpio_irq");
+    std::string command = argv[1];
+    bool ok = false;
+
+    if (command == "info") {
+        ok = print_info(irq);
+    } else if (command == "reset-counters") {
+        ok = irq.reset_counters();
+    } else if (command == "enable" && argc > 2) {
+        ok = irq.set_enabled_pins(static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 0)));
+    } else if (command == "irq-cpu" && argc > 2) {
+        ok = irq.set_irq_cpu(std::atoi(argv[2]));
+    } else if (command == "edge" && argc > 3) {
+        std::string edge = argv[3];
+        int value = (edge == "rising") ? FILTER_EDGE_RISING : (edge == "falling") ? FILTER_EDGE_FALLING : (edge == "both") ? FILTER_EDGE_BOTH : -1;
+        if (value < 0) {
+            print_usage();
+            return 1;
+        }
+        ok = update_filter(irq, static_cast<uint32_t>(std::atoi(argv[2])), value, -1, -1);
+    } else if (command == "filter" && argc > 4) {
+        ok = update_filter(irq, static_cast<uint32_t>(std::atoi(argv[2])), -1,
+                           std::strtoll(argv[3], nullptr, 10), std::strtoll(argv[4], nullptr, 10));
+    } else if (command == "ring" && argc > 2) {
+        std::vector<int> gpios;
+        for (int i = 3; i < argc; ++i) gpios.push_back(std::atoi(argv[i]));
+        ok = irq.reconfigure_ring(static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 0)), gpios);
+    } else if (command == "synth" && argc > 3) {
+        std::string pattern = argv[2];
+        RpiFastIrqSynth synth{};
+        if (!irq.get_synth(synth)) return 1;
+        int value = (pattern == "periodic") ? SYNTH_PATTERN_PERIODIC : (pattern == "poisson") ? SYNTH_PATTERN_POISSON : (pattern == "burst") ? SYNTH_PATTERN_BURST : -1;
+        if (value < 0) {
+            print_usage();
+            return 1;
+        }
+        synth.pattern = static_cast<uint32_t>(value);
+        synth.rate_hz = static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 0));
+        if (argc > 4) synth.pin_mask = static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 0));
+        if (argc > 5) synth.burst_len = static_cast<uint32_t>(std::strtoul(argv[5], nullptr, 0));
+        if (argc > 6) synth.burst_gap_us = static_cast<uint32_t>(std::strtoul(argv[6], nullptr, 0));
+        ok = irq.set_synth(synth);
+    } else {
+        print_usage();
+        return 1;
+    }
+
+    if (!ok) {
+        std::cerr << "\033[31m[irqctl] " << command << " failed.\033[0m\n";
+        return 1;
+    }
+    if (command != "info") std::cout << "[irqctl] " << command << ": done.\n";
+    return 0;
+}
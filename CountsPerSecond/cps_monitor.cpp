@@ -1,10 +1,10 @@
 /**
  * @file cps_monitor.cpp
- * @version 2.1.0
- * @date 2026-02-25
+ * @version 2.2.0
+ * @date 2026-10-14
  * @author Leonardo Lisa
  * @brief Real-time CPS monitor for GPIO interrupts based on absolute Hardware Timestamps.
- * @requirements RpiFastIrq library, kernel module loaded, root privileges for SCHED_FIFO.
+ * @requirements RpiFastIrq library, kernel module loaded, read access to /dev/rp1_gpio_irq.
  * * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License as published by
  * the Free Software Foundation, either version 3 of the License, or
@@ -17,7 +17,12 @@
 #include <thread>
 #include <csignal>
 #include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <algorithm>
 #include "RpiFastIrq.hpp"
+#include "RpiFastIrqMonitor.hpp"
+#include "RateEstimator.hpp"
 
 #define ANSI_RESET   "\033[0m"
 #define ANSI_BOLD    "\033[1m"
@@ -32,16 +37,12 @@
 
 std::atomic<bool> g_keep_running{true};
 
-// Store the hard real-time data generated directly by the kernel
-std::atomic<uint64_t> g_latest_timestamp_ns{0};
-std::atomic<uint32_t> g_latest_event_counter{0};
-
 void signal_handler(int signum) {
     (void)signum;
     g_keep_running.store(false, std::memory_order_release);
 }
 
-void print_banner() {
+void print_banner(unsigned pin_index) {
     std::cout << CLEAR_SCREEN;
     std::cout << ANSI_CYAN << ANSI_BOLD;
     std::cout << "  _____  _____  _____   __  __             _ _             \n";
@@ -52,58 +53,86 @@ void print_banner() {
     std::cout << " \\_____|_|    |_____/ |_|  |_|\\___/|_| |_|_|\\__\\___/|_|   \n";
     std::cout << ANSI_RESET << "\n";
     std::cout << "===========================================================\n";
-    std::cout << " Listening on /dev/rp1_gpio_irq | Press Ctrl+C to stop\n";
+    std::cout << " Listening on /dev/rp1_gpio_irq (pin index " << pin_index << ") | Press Ctrl+C to stop\n";
     std::cout << "===========================================================\n\n";
 }
 
-int main() {
+int main(int argc, char** argv) {
     std::signal(SIGINT, signal_handler);
-    std::cout << HIDE_CURSOR;
-    print_banner();
 
-    RpiFastIrq irq_handler("/dev/rp1_gpio_irq");
+    // event_counter is per pin, so the rate is computed on a single pin
+    unsigned pin_index = (argc > 1) ? static_cast<unsigned>(std::atoi(argv[1])) : 0;
+    // Rate window (1 ms .. 60 s) and display refresh period
+    uint64_t window_ms = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 1000;
+    int refresh_ms = (argc > 3) ? std::atoi(argv[3]) : 250;
+    if (refresh_ms < 10) refresh_ms = 10;
+    // "counters" samples the kernel's per-pin counters (read-only, default);
+    // "stream" attaches as a ring reader and feeds every event batch
+    std::string source = (argc > 4) ? argv[4] : "counters";
+    const bool stream = (source == "stream");
 
-    // The callback no longer counts events manually. 
-    // It simply stores the latest data packet certified by the kernel.
-    auto my_irq_callback = [](const GpioIrqEvent& event) {
-        g_latest_timestamp_ns.store(event.timestamp_ns, std::memory_order_relaxed);
-        g_latest_event_counter.store(event.event_counter, std::memory_order_relaxed);
-    };
+    std::cout << HIDE_CURSOR;
+    print_banner(pin_index);
 
-    if (!irq_handler.start(my_irq_callback)) {
-        std::cerr << ANSI_RED << "[Error] Failed to start IRQ listener." << ANSI_RESET << "\n";
+    // Read-only view of the per-pin counters kept by the kernel: no listener
+    // thread, no wakeups, and the real consumer keeps the ring to itself
+    RpiFastIrqMonitor irq_monitor("/dev/rp1_gpio_irq");
+    PinSample sample{};
+
+    if (!irq_monitor.open() || !irq_monitor.sample(pin_index, sample)) {
+        std::cerr << ANSI_RED << "[Error] Failed to open the IRQ counters of pin index " << pin_index << "." << ANSI_RESET << "\n";
         std::cout << SHOW_CURSOR;
         return 1;
     }
 
-    // Wait briefly to synchronize the first events
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    uint64_t prev_ts = g_latest_timestamp_ns.load(std::memory_order_relaxed);
-    uint32_t prev_counter = g_latest_event_counter.load(std::memory_order_relaxed);
+    RateEstimator rate(window_ms * 1000000ull);
+    rate.set_clock(irq_monitor.clock());
+
+    RpiFastIrq irq_reader("/dev/rp1_gpio_irq");
+    if (stream) {
+        ListenerConfig listener_config;
+        listener_config.self_check = false;
+        irq_reader.configure(listener_config);
+        if (!irq_reader.start_batch([&rate, pin_index](const GpioIrqEvent* first, size_t count) {
+                rate.on_batch(first, count, RpiFastIrq::pin_bit(pin_index));
+            })) {
+            std::cerr << ANSI_RED << "[Error] Failed to attach to the ring." << ANSI_RESET << "\n";
+            std::cout << SHOW_CURSOR;
+            return 1;
+        }
+    }
+
+    // Counter mode polls often enough to fill every bucket of the window
+    const auto poll_period = std::chrono::microseconds(std::clamp<uint64_t>(rate.window_ns() / RateEstimator::BUCKETS / 1000, 1000, refresh_ms * 1000ull));
+    const auto refresh_period = std::chrono::milliseconds(refresh_ms);
+    uint32_t prev_counter = sample.event_count;
 
-    auto next_tick = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    auto now = std::chrono::steady_clock::now();
+    auto next_poll = now + poll_period;
+    auto next_refresh = now + refresh_period;
     
     while (g_keep_running.load(std::memory_order_acquire)) {
-        std::this_thread::sleep_until(next_tick);
+        std::this_thread::sleep_until(stream ? next_refresh : std::min(next_poll, next_refresh));
         if (!g_keep_running.load(std::memory_order_acquire)) break;
-
-        uint64_t curr_ts = g_latest_timestamp_ns.load(std::memory_order_relaxed);
-        uint32_t curr_counter = g_latest_event_counter.load(std::memory_order_relaxed);
-        
-        uint32_t current_cps = 0;
-        uint64_t dt_ns = 0;
-        uint32_t delta_events = 0;
-
-        // Calculate the true frequency based on the Raspberry Pi hardware clock
-        if (curr_counter > prev_counter && curr_ts > prev_ts) {
-            dt_ns = curr_ts - prev_ts;
-            double dt_sec = dt_ns / 1e9;
-            delta_events = curr_counter - prev_counter;
-            current_cps = static_cast<uint32_t>((delta_events / dt_sec) + 0.5); // Round to nearest integer
+        now = std::chrono::steady_clock::now();
+
+        if (!stream && now >= next_poll) {
+            // All events since the previous poll are attributed to the
+            // newest timestamp, so the resolution is the poll period
+            irq_monitor.sample(pin_index, sample);
+            uint32_t delta_events = sample.event_count - prev_counter;
+            if (delta_events) {
+                rate.add(sample.last_timestamp, delta_events);
+                rate.publish();
+            }
+            prev_counter = sample.event_count;
+            next_poll += poll_period;
+            if (next_poll < now) next_poll = now + poll_period;
         }
+        if (now < next_refresh) continue;
 
-        prev_ts = curr_ts;
-        prev_counter = curr_counter;
+        RateSnapshot snap = rate.snapshot();
+        uint64_t current_cps = static_cast<uint64_t>(snap.window_hz + 0.5); // Round to nearest integer
         
         const char* color_code = ANSI_GREEN;
         if (current_cps > 50000) color_code = ANSI_RED;
@@ -113,16 +142,18 @@ int main() {
         std::cout << "\r" << CLEAR_LINE
                   << ANSI_BOLD << " Live Rate: " << color_code << std::setw(8) << current_cps 
                   << ANSI_RESET << " cps"
-                  //<< " | Debug -> Delta TS: " << dt_ns << " ns"
-                  //<< " | Delta Events: " << delta_events
+                  << " | EWMA: " << std::setw(8) << static_cast<uint64_t>(snap.ewma_hz + 0.5) << " cps"
+                  << " | Window: " << window_ms << " ms"
                   << std::flush;
 
-        next_tick += std::chrono::seconds(1);
+        next_refresh += refresh_period;
+        if (next_refresh < now) next_refresh = now + refresh_period;
     }
     
-    irq_handler.stop();
+    if (stream) irq_reader.stop();
+    irq_monitor.close();
     std::cout << "\n\n" << ANSI_YELLOW << "[System] Monitor stopped cleanly." << ANSI_RESET << "\n";
     std::cout << SHOW_CURSOR;
 
     return 0;
-}
\ No newline at end of file
+}
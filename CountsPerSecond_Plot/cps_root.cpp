@@ -1,7 +1,7 @@
 /**
  * @file cps_root.cpp
- * @version 1.1.0
- * @date 2026-02-26
+ * @version 1.2.0
+ * @date 2026-10-14
  * @author Leonardo Lisa
  * @brief Real-time CPS monitor with ROOT GUI for Raspberry Pi 5.
  * @requirements RpiFastIrq library, kernel module loaded, ROOT framework installed.
@@ -17,20 +17,19 @@
 #include <thread>
 #include <csignal>
 #include <algorithm>
+#include <cstdlib>
 #include <TApplication.h>
 #include <TCanvas.h>
 #include <TGraph.h>
 #include <TAxis.h>
 #include <TSystem.h>
-#include <TMath.h>
-#include "RpiFastIrq.hpp"
+#include <TString.h>
+#include "RpiFastIrqMonitor.hpp"
+#include "SlidingWindow.hpp"
+#include "RateEstimator.hpp"
 
 std::atomic<bool> g_keep_running{true};
 
-// Store the hard real-time data generated directly by the kernel
-std::atomic<uint64_t> g_latest_timestamp_ns{0};
-std::atomic<uint32_t> g_latest_event_counter{0};
-
 void signal_handler(int signum) {
     (void)signum;
     g_keep_running.store(false, std::memory_order_release);
@@ -39,6 +38,16 @@ void signal_handler(int signum) {
 int main(int argc, char** argv) {
     std::signal(SIGINT, signal_handler);
 
+    // event_counter is per pin, so the rate is computed on a single pin.
+    // Parsed before TApplication, which rewrites argc/argv.
+    unsigned pin_index = (argc > 1) ? static_cast<unsigned>(std::atoi(argv[1])) : 0;
+    // Visible window in seconds and bin width in ms; bins below 1 s give a
+    // sub-second rate, still computed from the kernel's per-pin counters
+    int window_sec = (argc > 2) ? std::atoi(argv[2]) : 60;
+    int bin_ms = (argc > 3) ? std::atoi(argv[3]) : 1000;
+    if (window_sec <= 0) window_sec = 60;
+    if (bin_ms < 10) bin_ms = 10;
+
     // Initialize ROOT application to handle GUI events
     TApplication app("CPS_ROOT_GUI", &argc, argv);
 
@@ -48,7 +57,7 @@ int main(int argc, char** argv) {
 
     // Setup Graph with points connected by line segments (PL)
     auto graph = new TGraph();
-    graph->SetTitle("Live Counts Per Second;Time (s);cps");
+    graph->SetTitle(bin_ms == 1000 ? "Live Counts Per Second;Time (s);cps" : Form("Live Counts Per Second (%d ms bins);Time (s);cps", bin_ms));
     graph->SetLineColor(kBlue);
     graph->SetLineWidth(2);
     graph->SetMarkerStyle(20);
@@ -56,30 +65,31 @@ int main(int argc, char** argv) {
     graph->SetMarkerColor(kRed);
     // Draw is deferred until the first point is added to avoid PaintGraph errors
 
-    // Initialize hardware IRQ listener
-    RpiFastIrq irq_handler("/dev/rp1_gpio_irq");
+    // The graph only ever holds the visible window: the points and their
+    // Y range come from a fixed-size window, so memory and redraw cost stay
+    // constant however long the monitor runs
+    SlidingWindow<uint32_t> window(static_cast<size_t>(window_sec) * 1000 / static_cast<size_t>(bin_ms) + 1);
 
-    // The callback no longer counts events manually. 
-    // It simply stores the latest data packet certified by the kernel.
-    auto my_irq_callback = [](const GpioIrqEvent& event) {
-        g_latest_timestamp_ns.store(event.timestamp_ns, std::memory_order_relaxed);
-        g_latest_event_counter.store(event.event_counter, std::memory_order_relaxed);
-    };
+    // Read-only view of the per-pin counters kept by the kernel: no listener
+    // thread, no wakeups, and the real consumer keeps the ring to itself
+    RpiFastIrqMonitor irq_monitor("/dev/rp1_gpio_irq");
+    PinSample sample{};
 
-    if (!irq_handler.start(my_irq_callback)) {
-        std::cerr << "[Error] Failed to start IRQ listener.\n";
+    if (!irq_monitor.open() || !irq_monitor.sample(pin_index, sample)) {
+        std::cerr << "[Error] Failed to open the IRQ counters of pin index " << pin_index << ".\n";
         return 1;
     }
 
     std::cout << "[System] ROOT GUI started. Press Ctrl+C in terminal or close the window to exit.\n";
 
-    // Wait briefly to synchronize the first events
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    uint64_t prev_ts = g_latest_timestamp_ns.load(std::memory_order_relaxed);
-    uint32_t prev_counter = g_latest_event_counter.load(std::memory_order_relaxed);
+    // Fed from the counters on every GUI iteration, read once per bin
+    RateEstimator rate(static_cast<uint64_t>(bin_ms) * 1000000ull);
+    rate.set_clock(irq_monitor.clock());
+    uint32_t prev_counter = sample.event_count;
 
-    int time_sec = 0;
-    auto next_tick = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    const auto bin_period = std::chrono::milliseconds(bin_ms);
+    const auto start_time = std::chrono::steady_clock::now();
+    auto next_tick = start_time + bin_period;
     bool first_draw = true;
 
     // Main GUI and Data Polling Loop
@@ -87,62 +97,62 @@ int main(int argc, char** argv) {
         // Process ROOT GUI events to keep window responsive
         gSystem->ProcessEvents();
 
+        // The events since the previous iteration are attributed to the
+        // newest hardware timestamp
+        irq_monitor.sample(pin_index, sample);
+        uint32_t delta_events = sample.event_count - prev_counter;
+        if (delta_events) {
+            rate.add(sample.last_timestamp, delta_events);
+            rate.publish();
+        }
+        prev_counter = sample.event_count;
+
         auto now = std::chrono::steady_clock::now();
         if (now >= next_tick) {
-            uint64_t curr_ts = g_latest_timestamp_ns.load(std::memory_order_relaxed);
-            uint32_t curr_counter = g_latest_event_counter.load(std::memory_order_relaxed);
+            uint32_t current_cps = static_cast<uint32_t>(rate.snapshot().window_hz + 0.5); // Round to nearest integer
             
-            uint32_t current_cps = 0;
-            uint64_t dt_ns = 0;
-            uint32_t delta_events = 0;
-
-            // Calculate the true frequency based on the Raspberry Pi hardware clock
-            if (curr_counter > prev_counter && curr_ts > prev_ts) {
-                dt_ns = curr_ts - prev_ts;
-                double dt_sec = dt_ns / 1e9;
-                delta_events = curr_counter - prev_counter;
-                current_cps = static_cast<uint32_t>((delta_events / dt_sec) + 0.5); // Round to nearest integer
-            }
+            // Append the point to the window, dropping the oldest one when full
+            const double time_sec = std::chrono::duration<double>(now - start_time).count();
+            window.push(time_sec, current_cps);
 
-            prev_ts = curr_ts;
-            prev_counter = curr_counter;
-            
-            // Append point to the graph
-            graph->SetPoint(graph->GetN(), time_sec, current_cps);
-            time_sec++;
+            // Rebuild the graph from the window alone
+            const int n = static_cast<int>(window.size());
+            graph->Set(n);
+            for (int i = 0; i < n; ++i) graph->SetPoint(i, window.x(i), window.y(i));
 
-            // Rescale X axis to maintain a sliding 60-second window for real-time tracking
-            graph->GetXaxis()->SetLimits(std::max(0, time_sec - 60), std::max(60, time_sec + 5));
+            // Sliding X window for real-time tracking
+            graph->GetXaxis()->SetLimits(std::max(0.0, time_sec - window_sec), std::max(static_cast<double>(window_sec), time_sec + window_sec / 12.0));
             
-            // Apply dynamic symmetric offset to Y axis
-            if (graph->GetN() > 0) {
-                double min_y = TMath::MinElement(graph->GetN(), graph->GetY());
-                double max_y = TMath::MaxElement(graph->GetN(), graph->GetY());
-                
-                double offset = (max_y - min_y) * 0.1;
-                if (offset == 0) offset = max_y * 0.1; 
-                if (offset == 0) offset = 1.0; 
-                
-                graph->GetYaxis()->SetRangeUser(min_y - offset, max_y + offset);
-
-                // Draw only after the first point is available
-                if (first_draw) {
-                    graph->Draw("APL");
-                    first_draw = false;
-                }
+            // Apply dynamic symmetric offset to Y axis, O(1) from the window
+            double min_y = window.min_y();
+            double max_y = window.max_y();
+
+            double offset = (max_y - min_y) * 0.1;
+            if (offset == 0) offset = max_y * 0.1; 
+            if (offset == 0) offset = 1.0; 
+
+            graph->GetYaxis()->SetRangeUser(min_y - offset, max_y + offset);
+
+            // Draw only after the first point is available
+            if (first_draw) {
+                graph->Draw("APL");
+                first_draw = false;
             }
             
             // Force redraw
             canvas->Modified();
             canvas->Update();
 
-            next_tick += std::chrono::seconds(1);
+            // Skip the bins missed while the GUI was blocked instead of
+            // replaying them back to back
+            next_tick += bin_period;
+            if (next_tick < now) next_tick = now + bin_period;
         }
 
         // 20ms sleep to prevent the GUI polling loop from hogging the CPU core
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::min(20, bin_ms / 2)));
     }
 
-    irq_handler.stop();
+    irq_monitor.close();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,262 @@
+/**
+ * @file exporter.cpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Drains the ring in batches and ships the events as UDP frames (sendmmsg) to a central receiver.
+ * @requirements RpiFastIrq library, kernel module loaded, write access to /dev/rp1_gpio_irq, network access to the receiver.
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <random>
+#include <string>
+#include <ctime>
+#include <poll.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "RpiFastIrq.hpp"
+#include "stream_format.h"
+
+std::atomic<bool> g_keep_running{true};
+
+void signal_handler(int signum) {
+    (void)signum;
+    g_keep_running.store(false, std::memory_order_release);
+}
+
+// Frames are filled in place and sent in groups of up to BATCH_FRAMES with
+// one sendmmsg() call. The pool is reused as soon as the call returns: the
+// datagrams are around 1 KiB, where MSG_ZEROCOPY costs more in page pinning
+// and completion handling than the copy it saves.
+class FrameSender {
+public:
+    static constexpr size_t BATCH_FRAMES = 32;
+
+    bool open(const std::string& host, const std::string& port) {
+        struct addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo* result = nullptr;
+        int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+        if (err != 0) {
+            std::cerr << "\033[31m[Export] Cannot resolve " << host << ":" << port << ": " << gai_strerror(err) << "\033[0m\n";
+            return false;
+        }
+        for (struct addrinfo* ai = result; ai != nullptr; ai = ai->ai_next) {
+            m_socket = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+            if (m_socket < 0) continue;
+            // Connected: sendmmsg() needs no per-message address
+            if (::connect(m_socket, ai->ai_addr, ai->ai_addrlen) == 0) break;
+            ::close(m_socket);
+            m_socket = -1;
+        }
+        freeaddrinfo(result);
+        if (m_socket < 0) {
+            std::cerr << "\033[31m[Export] Cannot connect a UDP socket to " << host << ":" << port << ": " << std::strerror(errno) << "\033[0m\n";
+            return false;
+        }
+        int sndbuf = 4 << 20;
+        setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        return true;
+    }
+
+    void close() {
+        if (m_socket >= 0) ::close(m_socket);
+        m_socket = -1;
+    }
+
+    // Frame being filled, nullptr when the pool is full (send() first)
+    StreamFrame* current() { return m_used < BATCH_FRAMES ? &m_frames[m_used] : nullptr; }
+    void commit() { m_used++; }
+    size_t used() const { return m_used; }
+
+    // Sends frames [0, used()); returns false on a socket error. Frames
+    // the kernel refused are counted in dropped_frames(). A partially
+    // filled frame passed in open is moved to the front of the pool.
+    bool send(StreamFrame** open = nullptr) {
+        if (m_used == 0) return true;
+        struct iovec iov[BATCH_FRAMES];
+        struct mmsghdr msgs[BATCH_FRAMES];
+        std::memset(msgs, 0, sizeof(msgs));
+        for (size_t i = 0; i < m_used; ++i) {
+            iov[i].iov_base = &m_frames[i];
+            iov[i].iov_len = sizeof(StreamFrameHeader) + m_frames[i].header.event_count * sizeof(GpioIrqEvent);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        size_t sent = 0;
+        size_t refused = 0;
+        bool ok = true;
+        while (sent < m_used) {
+            int n = ::sendmmsg(m_socket, msgs + sent, static_cast<unsigned>(m_used - sent), 0);
+            if (n > 0) {
+                sent += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            // ECONNREFUSED (receiver not up yet), ENOBUFS...: the frame is
+            // lost, the receiver sees the sequence gap
+            if (errno != m_last_errno) {
+                std::cerr << "\033[33m[Export] sendmmsg: " << std::strerror(errno) << "\033[0m\n";
+                m_last_errno = errno;
+            }
+            refused++;
+            sent++;
+            ok = false;
+        }
+        if (ok) m_last_errno = 0;
+        m_frames_sent += m_used - refused;
+        m_dropped += refused;
+        if (open != nullptr && *open != nullptr && *open != &m_frames[0]) {
+            const StreamFrame& partial = **open;
+            m_frames[0].header = partial.header;
+            std::memcpy(m_frames[0].events, partial.events, partial.header.event_count * sizeof(GpioIrqEvent));
+            *open = &m_frames[0];
+        }
+        m_used = 0;
+        return ok;
+    }
+
+    uint64_t frames_sent() const { return m_frames_sent; }
+    uint64_t dropped_frames() const { return m_dropped; }
+
+private:
+    int m_socket = -1;
+    StreamFrame m_frames[BATCH_FRAMES];
+    size_t m_used = 0;
+    uint64_t m_frames_sent = 0;
+    uint64_t m_dropped = 0;
+    int m_last_errno = 0;
+};
+
+// CLOCK_REALTIME - CLOCK_MONOTONIC, the monotonic reading taken on both
+// sides of the realtime one
+int64_t realtime_offset_ns(uint64_t& monotonic_ns) {
+    struct timespec mono_before, real, mono_after;
+    clock_gettime(CLOCK_MONOTONIC, &mono_before);
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(CLOCK_MONOTONIC, &mono_after);
+    auto ns = [](const struct timespec& ts) { return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec); };
+    monotonic_ns = ns(mono_before) + (ns(mono_after) - ns(mono_before)) / 2;
+    return static_cast<int64_t>(ns(real) - monotonic_ns);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: irq_export.x <host> [port] [node_id] [max_hold_ms] [pin_mask]\n";
+        return 1;
+    }
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    std::string host = argv[1];
+    std::string port = (argc > 2) ? argv[2] : std::to_string(STREAM_DEFAULT_PORT);
+    uint32_t node_id = (argc > 3) ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 0)) : 0;
+    // Upper bound on how long an event waits in a partial frame
+    int max_hold_ms = (argc > 4) ? std::atoi(argv[4]) : 5;
+    if (max_hold_ms < 1) max_hold_ms = 1;
+    uint32_t pin_mask = (argc > 5) ? static_cast<uint32_t>(std::strtoul(argv[5], nullptr, 0)) : RpiFastIrq::ALL_PINS;
+
+    FrameSender sender;
+    if (!sender.open(host, port)) return 1;
+
+    // Threadless: drain, framing and sending share this thread
+    RpiFastIrq irq_handler("/dev/rp1_gpio_irq");
+    irq_handler.subscribe(pin_mask);
+    if (!irq_handler.open()) return 1;
+    const RingClock& clock = irq_handler.clock();
+
+    StreamFrameHeader header_template{};
+    header_template.magic = STREAM_MAGIC;
+    header_template.version = STREAM_VERSION;
+    header_template.header_size = sizeof(StreamFrameHeader);
+    header_template.node_id = node_id;
+    header_template.clock_mode = clock.mode;
+    header_template.session = std::random_device{}();
+    header_template.counter_freq_hz = clock.freq_hz;
+    header_template.clock_ref_ticks = clock.ref_ticks;
+    header_template.clock_ref_ns = clock.ref_ns;
+
+    uint64_t sequence = 0;
+    uint64_t events_sent = 0;
+    StreamFrame* frame = nullptr;
+    auto frame_opened = std::chrono::steady_clock::now();
+
+    // Stamps the header and moves the frame into the send batch
+    auto close_frame = [&]() {
+        StreamFrameHeader& h = frame->header;
+        uint32_t count = h.event_count;
+        h = header_template;
+        h.event_count = count;
+        h.sequence = sequence++;
+        h.first_event = events_sent;
+        h.timebase_offset_ns = realtime_offset_ns(h.send_monotonic_ns);
+        const SyncClock& sync = irq_handler.sync_clock();
+        if (sync.valid()) {
+            // The drift of the ring clock over one frame is far below a ns
+            const uint64_t first = frame->events[0].timestamp_ns;
+            h.timebase = STREAM_TIMEBASE_TAI;
+            h.timebase_offset_ns = static_cast<int64_t>(sync.to_sync_ns(first) - clock.to_ns(first));
+            h.sync_uncertainty_ns = sync.uncertainty_ns;
+        }
+        events_sent += count;
+        sender.commit();
+        frame = nullptr;
+    };
+
+    auto append = [&](const GpioIrqEvent& event) {
+        if (frame == nullptr) {
+            if (sender.current() == nullptr) sender.send();
+            frame = sender.current();
+            frame->header.event_count = 0;
+            frame_opened = std::chrono::steady_clock::now();
+        }
+        frame->events[frame->header.event_count++] = event;
+        if (frame->header.event_count == STREAM_FRAME_EVENTS) close_frame();
+    };
+
+    std::cerr << "[Export] Node " << node_id << " -> " << host << ":" << port << ", frames of " << STREAM_FRAME_EVENTS
+              << " events, hold " << max_hold_ms << " ms, timebase "
+              << (irq_handler.sync_clock().sync_clock == SYNC_CLOCK_TAI ? "CLOCK_TAI (module clock pairs)" : "CLOCK_REALTIME")
+              << ". Ctrl+C to stop.\n";
+
+    struct pollfd pfd = {irq_handler.fd(), POLLIN, 0};
+    auto last_ui_update = std::chrono::steady_clock::now();
+    while (g_keep_running.load(std::memory_order_acquire)) {
+        if (::poll(&pfd, 1, max_hold_ms) > 0) irq_handler.drain(append);
+
+        // Full frames go out after every drain, a partial one once its
+        // first event has waited max_hold_ms
+        auto now = std::chrono::steady_clock::now();
+        if (frame != nullptr && now - frame_opened >= std::chrono::milliseconds(max_hold_ms)) close_frame();
+        sender.send(&frame);
+
+        if (now - last_ui_update >= std::chrono::seconds(1)) {
+            std::cerr << "\r[Export] Events: " << events_sent << " | Frames: " << sender.frames_sent()
+                      << " | Send Drops: " << sender.dropped_frames()
+                      << " | Ring Overruns: " << irq_handler.ring_stats().kernel_overruns << std::flush;
+            last_ui_update = now;
+        }
+    }
+
+    if (frame != nullptr) close_frame();
+    sender.send();
+    std::cerr << "\n[Export] " << events_sent << " events in " << sender.frames_sent() << " frames, "
+              << sender.dropped_frames() << " frames not sent.\n";
+    irq_handler.close();
+    sender.close();
+    return 0;
+}
@@ -0,0 +1,352 @@
+/**
+ * @file receiver.cpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Central receiver of irq_export.x frames: loss accounting per node and a timestamp-ordered merge of all nodes.
+ * @requirements C++17, Linux (recvmmsg). No kernel module needed on the receiving host.
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "RpiFastIrq.hpp"
+#include "stream_format.h"
+
+std::atomic<bool> g_keep_running{true};
+
+void signal_handler(int signum) {
+    (void)signum;
+    g_keep_running.store(false, std::memory_order_release);
+}
+
+// One event on the common timebase (STREAM_TIMEBASE_* of its node)
+struct MergedEvent {
+    uint64_t time_ns;
+    uint32_t node_id;
+    GpioIrqEvent event;
+};
+
+// Per-node state. The queue is allocated once, when the node first shows up.
+struct NodeState {
+    static constexpr size_t QUEUE_CAPACITY = 16384;  // Power of two
+
+    bool used = false;
+    uint32_t node_id = 0;
+    uint32_t session = 0;
+    uint64_t next_sequence = 0;
+    uint64_t next_event = 0;
+    uint64_t frames = 0;
+    uint64_t events = 0;
+    uint64_t lost_frames = 0;
+    uint64_t lost_events = 0;
+    uint64_t reordered = 0;        // Frames older than the expected sequence
+    uint64_t queue_drops = 0;      // Merge queue full: the merge could not wait for the other nodes
+    int64_t timebase_offset_ns = 0;
+    uint32_t timebase = STREAM_TIMEBASE_REALTIME;
+    uint64_t watermark_ns = 0;     // Newest event time received from this node
+    std::chrono::steady_clock::time_point last_frame;
+
+    std::vector<MergedEvent> queue;
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    size_t size() const { return static_cast<size_t>(tail - head); }
+    const MergedEvent& front() const { return queue[head & (QUEUE_CAPACITY - 1)]; }
+};
+
+class Receiver {
+public:
+    static constexpr size_t MAX_NODES = 16;
+    static constexpr size_t BATCH = 32;
+
+    Receiver(std::ostream& out, uint64_t hold_ns) : m_out(out), m_hold_ns(hold_ns) {}
+
+    bool open(uint16_t port) {
+        // Dual-stack IPv6 socket, plain IPv4 where IPv6 is disabled
+        m_socket = ::socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (m_socket >= 0) {
+            int off = 0;
+            setsockopt(m_socket, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+            struct sockaddr_in6 addr{};
+            addr.sin6_family = AF_INET6;
+            addr.sin6_addr = in6addr_any;
+            addr.sin6_port = htons(port);
+            if (::bind(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+                ::close(m_socket);
+                m_socket = -1;
+            }
+        }
+        if (m_socket < 0) {
+            m_socket = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            struct sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            addr.sin_port = htons(port);
+            if (m_socket < 0 || ::bind(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+                std::cerr << "\033[31m[Receive] Cannot bind UDP port " << port << ": " << std::strerror(errno) << "\033[0m\n";
+                return false;
+            }
+        }
+        int rcvbuf = 8 << 20;
+        setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        return true;
+    }
+
+    int fd() const { return m_socket; }
+
+    // Reads every datagram already queued on the socket, BATCH per call
+    void receive() {
+        struct iovec iov[BATCH];
+        struct mmsghdr msgs[BATCH];
+        while (true) {
+            std::memset(msgs, 0, sizeof(msgs));
+            for (size_t i = 0; i < BATCH; ++i) {
+                iov[i].iov_base = &m_frames[i];
+                iov[i].iov_len = sizeof(StreamFrame);
+                msgs[i].msg_hdr.msg_iov = &iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            int n = ::recvmmsg(m_socket, msgs, BATCH, MSG_DONTWAIT, nullptr);
+            if (n <= 0) return;
+            m_last_datagram = std::chrono::steady_clock::now();
+            for (int i = 0; i < n; ++i) handle_frame(m_frames[i], msgs[i].msg_len);
+            if (static_cast<size_t>(n) < BATCH) return;
+        }
+    }
+
+    // Releases the merged events in time order. With force (idle input or
+    // shutdown) everything queued goes out.
+    void merge(bool force) {
+        while (true) {
+            NodeState* oldest = nullptr;
+            uint64_t min_watermark = UINT64_MAX;
+            uint64_t max_watermark = 0;
+            auto now = std::chrono::steady_clock::now();
+            // For one hold period after the first frame, other nodes may
+            // not have been seen yet
+            if (now - m_first_frame < std::chrono::nanoseconds(m_hold_ns)) min_watermark = 0;
+            for (NodeState& node : m_nodes) {
+                if (!node.used) continue;
+                if (node.size() && (oldest == nullptr || node.front().time_ns < oldest->front().time_ns)) oldest = &node;
+                // A node silent for a second no longer holds the merge back
+                if (now - node.last_frame < std::chrono::seconds(1) && node.watermark_ns < min_watermark) min_watermark = node.watermark_ns;
+                if (node.watermark_ns > max_watermark) max_watermark = node.watermark_ns;
+            }
+            if (oldest == nullptr) return;
+
+            // Safe once every live node has sent something newer, or once
+            // a lagging node has had hold_ms to catch up
+            const uint64_t ts = oldest->front().time_ns;
+            if (!force && ts > min_watermark && ts + m_hold_ns > max_watermark) return;
+            release(*oldest);
+        }
+    }
+
+    bool idle(std::chrono::milliseconds period) const { return std::chrono::steady_clock::now() - m_last_datagram >= period; }
+
+    void print_status(std::ostream& os) const {
+        uint64_t events = 0, lost = 0;
+        size_t nodes = 0;
+        for (const NodeState& node : m_nodes) {
+            if (!node.used) continue;
+            nodes++;
+            events += node.events;
+            lost += node.lost_events;
+        }
+        os << "\r[Receive] Nodes: " << nodes << " | Events: " << events << " | Lost Events: " << lost
+           << " | Merged: " << m_merged << " | Out-of-Order: " << m_out_of_order << " | Bad Datagrams: " << m_bad << std::flush;
+    }
+
+    void print_summary(std::ostream& os) const {
+        for (const NodeState& node : m_nodes) {
+            if (!node.used) continue;
+            os << "# Node " << node.node_id << ": frames " << node.frames << ", events " << node.events
+               << ", lost frames " << node.lost_frames << ", lost events " << node.lost_events
+               << ", reordered " << node.reordered << ", queue drops " << node.queue_drops
+               << ", timebase " << (node.timebase == STREAM_TIMEBASE_TAI ? "TAI" : "REALTIME")
+               << " offset " << node.timebase_offset_ns << " ns\n";
+        }
+        os << "# Merged_Events: " << m_merged << "\n"
+           << "# Out_Of_Order_Events: " << m_out_of_order << "\n"
+           << "# Bad_Datagrams: " << m_bad << "\n";
+    }
+
+private:
+    NodeState* find_node(uint32_t node_id) {
+        NodeState* free_slot = nullptr;
+        for (NodeState& node : m_nodes) {
+            if (node.used && node.node_id == node_id) return &node;
+            if (!node.used && free_slot == nullptr) free_slot = &node;
+        }
+        if (free_slot == nullptr) return nullptr;
+        if (m_node_count++ == 0) m_first_frame = std::chrono::steady_clock::now();
+        free_slot->used = true;
+        free_slot->node_id = node_id;
+        free_slot->queue.resize(NodeState::QUEUE_CAPACITY);
+        std::cerr << "\n[Receive] New node " << node_id << "\n";
+        return free_slot;
+    }
+
+    void handle_frame(const StreamFrame& frame, size_t length) {
+        const StreamFrameHeader& h = frame.header;
+        if (length < sizeof(StreamFrameHeader) || h.magic != STREAM_MAGIC || h.version != STREAM_VERSION ||
+            h.header_size != sizeof(StreamFrameHeader) || h.timebase > STREAM_TIMEBASE_TAI || h.event_count == 0 || h.event_count > STREAM_FRAME_EVENTS ||
+            length != sizeof(StreamFrameHeader) + h.event_count * sizeof(GpioIrqEvent)) {
+            m_bad++;
+            return;
+        }
+        NodeState* node = find_node(h.node_id);
+        if (node == nullptr) {
+            m_bad++;
+            return;
+        }
+
+        // A new session is a restarted exporter, not a loss
+        if (node->frames == 0 || h.session != node->session) {
+            node->session = h.session;
+            node->next_sequence = h.sequence;
+            node->next_event = h.first_event;
+        }
+        if (h.sequence > node->next_sequence) {
+            node->lost_frames += h.sequence - node->next_sequence;
+            node->lost_events += h.first_event - node->next_event;
+        } else if (h.sequence < node->next_sequence) {
+            // Late datagram: its events were counted as lost already
+            node->reordered++;
+            if (node->lost_frames) node->lost_frames--;
+            if (node->lost_events >= h.event_count) node->lost_events -= h.event_count;
+        }
+        if (h.sequence >= node->next_sequence) {
+            node->next_sequence = h.sequence + 1;
+            node->next_event = h.first_event + h.event_count;
+        }
+        node->frames++;
+        node->events += h.event_count;
+        node->timebase_offset_ns = h.timebase_offset_ns;
+        if (h.timebase != node->timebase || node->frames == 1) {
+            node->timebase = h.timebase;
+            check_timebases();
+        }
+        node->last_frame = std::chrono::steady_clock::now();
+
+        RingClock clock;
+        clock.mode = h.clock_mode;
+        clock.freq_hz = h.counter_freq_hz ? h.counter_freq_hz : 1000000000u;
+        clock.ref_ticks = h.clock_ref_ticks;
+        clock.ref_ns = h.clock_ref_ns;
+
+        for (uint32_t i = 0; i < h.event_count; ++i) {
+            if (node->size() == NodeState::QUEUE_CAPACITY) {
+                // Cannot wait any longer for the other nodes
+                node->queue_drops++;
+                release(*node);
+            }
+            MergedEvent& slot = node->queue[node->tail++ & (NodeState::QUEUE_CAPACITY - 1)];
+            slot.time_ns = static_cast<uint64_t>(static_cast<int64_t>(clock.to_ns(frame.events[i].timestamp_ns)) + h.timebase_offset_ns);
+            slot.node_id = h.node_id;
+            slot.event = frame.events[i];
+            if (slot.time_ns > node->watermark_ns) node->watermark_ns = slot.time_ns;
+        }
+    }
+
+    // TAI and REALTIME differ by the leap seconds: mixed nodes do not merge
+    void check_timebases() {
+        uint32_t seen = 0;
+        for (const NodeState& node : m_nodes) {
+            if (node.used && node.frames) seen |= 1u << node.timebase;
+        }
+        if (seen == 0x3) std::cerr << "\n\033[33m[Receive] Warning: nodes on TAI and on REALTIME timebases, the merge is off by the TAI-UTC offset\033[0m\n";
+    }
+
+    void release(NodeState& node) {
+        const MergedEvent& e = node.front();
+        if (e.time_ns < m_released_ns) m_out_of_order++;
+        else m_released_ns = e.time_ns;
+        m_out << e.time_ns << " " << e.node_id << " " << e.event.pin_index << " " << e.event.event_counter
+              << " " << static_cast<unsigned>(e.event.flags) << "\n";
+        m_merged++;
+        node.head++;
+    }
+
+    std::ostream& m_out;
+    uint64_t m_hold_ns;
+    int m_socket = -1;
+    StreamFrame m_frames[BATCH];
+    NodeState m_nodes[MAX_NODES];
+    std::chrono::steady_clock::time_point m_first_frame;
+    size_t m_node_count = 0;
+    std::chrono::steady_clock::time_point m_last_datagram;
+    uint64_t m_released_ns = 0;
+    uint64_t m_merged = 0;
+    uint64_t m_out_of_order = 0;
+    uint64_t m_bad = 0;
+};
+
+int main(int argc, char** argv) {
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    uint16_t port = (argc > 1) ? static_cast<uint16_t>(std::atoi(argv[1])) : STREAM_DEFAULT_PORT;
+    // How long the merge waits for a lagging node
+    int hold_ms = (argc > 2) ? std::atoi(argv[2]) : 100;
+    if (hold_ms < 1) hold_ms = 1;
+    std::string output = (argc > 3) ? argv[3] : "";
+
+    if (output.empty()) {
+        auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::stringstream ss;
+        ss << "merged_" << std::put_time(std::localtime(&now), "%H-%M-%S_%d-%m-%Y") << ".dat";
+        output = ss.str();
+    }
+    std::ofstream file;
+    if (output != "-") {
+        file.open(output);
+        if (!file.is_open()) {
+            std::cerr << "\033[31m[Error] Could not create " << output << ".\033[0m" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = (output == "-") ? std::cout : file;
+    out << "# Columns: time_ns node_id pin_index event_counter flags\n";
+
+    Receiver receiver(out, static_cast<uint64_t>(hold_ms) * 1000000ull);
+    if (!receiver.open(port)) return 1;
+    std::cerr << "[Receive] Listening on UDP port " << port << ", merge hold " << hold_ms << " ms. Ctrl+C to stop.\n";
+
+    struct pollfd pfd = {receiver.fd(), POLLIN, 0};
+    auto last_ui_update = std::chrono::steady_clock::now();
+    while (g_keep_running.load(std::memory_order_acquire)) {
+        if (::poll(&pfd, 1, hold_ms) > 0) receiver.receive();
+        // With no traffic for hold_ms nothing older can still arrive
+        receiver.merge(receiver.idle(std::chrono::milliseconds(hold_ms)));
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_ui_update >= std::chrono::seconds(1)) {
+            receiver.print_status(std::cerr);
+            last_ui_update = now;
+        }
+    }
+
+    receiver.merge(true);
+    receiver.print_summary(out);
+    std::cerr << "\n";
+    receiver.print_summary(std::cerr);
+    return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file stream_format.h
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Wire layout of the UDP event frames sent by irq_export.x and merged by irq_receive.x.
+ * @requirements C++17
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Datagram layout (little endian, the native order of the Pi 5):
+ *   [0, sizeof(StreamFrameHeader))  StreamFrameHeader
+ *   [header_size, ..)               event_count GpioIrqEvent records, as read from the ring
+ *
+ * sequence counts frames per node from 0, first_event counts events, so a
+ * receiver detects lost frames and knows how many events they carried.
+ * Timestamps stay in the ring's clock (CLOCK_MONOTONIC ns or raw ticks);
+ * the clock fields convert them to CLOCK_MONOTONIC ns and timebase_offset_ns
+ * maps that onto the common timebase of the nodes: CLOCK_TAI from the
+ * module's drift-corrected clock pairs when it samples them
+ * (sync_period_ms), CLOCK_REALTIME otherwise. Either is as good as the
+ * NTP/PTP synchronization of the nodes.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// GpioIrqEvent, CLOCK_MODE_* (relative path, like capture_format.h)
+#include "../kernel_module/rpi_fast_irq_uapi.h"
+
+#define STREAM_MAGIC          0x51524946u   // "FIRQ"
+#define STREAM_VERSION        2
+#define STREAM_DEFAULT_PORT   5588
+#define STREAM_FRAME_EVENTS   64            // 1112-byte datagrams, below a 1500-byte MTU
+
+// Timebase of timebase_offset_ns
+#define STREAM_TIMEBASE_REALTIME 0          // CLOCK_REALTIME - CLOCK_MONOTONIC at send time
+#define STREAM_TIMEBASE_TAI      1          // Module clock pairs (SyncClock) at the first event
+
+struct StreamFrameHeader {
+    uint32_t magic;              // STREAM_MAGIC
+    uint16_t version;            // STREAM_VERSION
+    uint16_t header_size;        // Byte offset of the first record
+    uint32_t node_id;            // Chosen per node on the exporter command line
+    uint32_t event_count;        // Records in this frame, 1..STREAM_FRAME_EVENTS
+    uint64_t sequence;           // Frame number of this node, from 0
+    uint64_t first_event;        // Events this node sent before this frame
+    uint32_t clock_mode;         // CLOCK_MODE_* of timestamp_ns
+    uint32_t session;            // Random per exporter run: sequence restarts are not losses
+    uint64_t counter_freq_hz;    // Clock parameters of the ring (see SharedRingMeta)
+    uint64_t clock_ref_ticks;
+    uint64_t clock_ref_ns;
+    int64_t timebase_offset_ns;  // Timebase - CLOCK_MONOTONIC, for the events of this frame
+    uint64_t send_monotonic_ns;  // CLOCK_MONOTONIC when the frame was sent
+    uint32_t timebase;           // STREAM_TIMEBASE_*
+    uint32_t sync_uncertainty_ns; // STREAM_TIMEBASE_TAI: read window of the module's latest pair
+};
+
+static_assert(sizeof(StreamFrameHeader) == 88, "stream frame header layout changed");
+
+struct StreamFrame {
+    StreamFrameHeader header;
+    GpioIrqEvent events[STREAM_FRAME_EVENTS];
+};
@@ -1,6 +1,6 @@
 /**
  * @file rpi_fast_irq.c
- * @version 2.0.0
+ * @version 2.2.0
  * @date 2026-02-25
  * @author Leonardo Lisa
  * @brief Zero-copy, lock-free GPIO interrupt handler for RPi5 using mmap and noncached memory.
@@ -30,11 +30,67 @@
  * Run: cat /sys/class/gpio/gpiochip* /label
  * Find the chip labeled "pinctrl-rp1". Let's say its base is 512.
  * Your logical GPIO will be: Base (512) + Pin (17) = 529.
- * Update the GPIO_PIN macro below if necessary.
+ * Pass the logical GPIOs through the "pins" module parameter (see step 4).
  * * 3. COMPILE THE MODULE:
  * Run: make
  * * 4. INSTALL THE MODULE:
  * sudo insmod rpi_fast_irq.ko
+ * To listen on several pins with a single module (max MAX_PINS):
+ * sudo insmod rpi_fast_irq.ko pins=588,589,590
+ * Events of all pins share one ring and carry the index of their pin
+ * in the "pins" list (pin_index), so one wakeup covers a correlated burst.
+ * The ring capacity (power of two) is also chosen at load time:
+ * sudo insmod rpi_fast_irq.ko ring_size=65536
+ * When the ring is full the ISR either overwrites the oldest unread event
+ * (overflow_policy=0, default) or drops the new one (overflow_policy=1).
+ * Both cases are counted in the "overruns" field of the header page.
+ * The header page also holds per-pin event counts and last timestamps, so
+ * rate monitors can map it read-only without consuming the ring.
+ * Up to RING_MAX_READERS processes can consume the ring at the same time:
+ * the first writable mmap() of an open file claims its own tail/spinning
+ * slot in the header page (RPI_FAST_IRQ_IOC_READER_SLOT), and poll() tests
+ * that slot only. Opens used for control ioctls alone claim none.
+ * With raw_ticks=1 (arm64) the ISR stores raw CNTVCT_EL0 ticks instead of
+ * CLOCK_MONOTONIC ns. The counter frequency and a (ticks, ns) reference pair
+ * are published in the header page for lazy conversion in user space.
+ * event_format=1 selects the compact 8-byte record (48-bit timestamp, pin
+ * index, level bits, sequence delta): 8 events per cache line instead of 4.
+ * sample_level=1 reads the pin level in the ISR (one extra RP1 PCIe read).
+ * Interrupt moderation for high-rate inputs: with coalesce_events=N (N > 1)
+ * user space is woken every N events, or coalesce_us after the first
+ * pending event, whichever comes first. Every edge is still timestamped.
+ * sudo insmod rpi_fast_irq.ko coalesce_events=64 coalesce_us=200
+ * The pin IRQs are bound to CPU irq_cpu (default 3, the isolated core) with
+ * a hard affinity, not just a hint; irq_cpu=-1 keeps the kernel default.
+ * sudo insmod rpi_fast_irq.ko irq_cpu=2
+ * An optional per-pin filter (RPI_FAST_IRQ_IOC_SET_FILTER) selects the edges
+ * (rising/falling/both), enforces a minimum spacing (deadtime) and keeps 1
+ * in N edges (prescale). Rejected edges never touch the ring.
+ * The control ioctls (RPI_FAST_IRQ_IOC_*) query the module state, reset the
+ * loss counters, enable/disable pin IRQs, move them to another CPU and
+ * rebuild the ring with a new size or pin list without reloading.
+ * trace_latency=1 adds a GpioIrqTraceRecord per event slot with the ISR
+ * entry, wakeup and exit times, for end-to-end latency measurements.
+ * capture_engine=1 timestamps the edges in hardware instead: one RP1 PIO
+ * state machine per pin (max 4, RP1 bank 0 GPIOs) counts PIO clock cycles
+ * and DMAs the count of every rising edge, pio_batch edges at a time, to a
+ * capture thread that publishes them in the same ring format. There is no
+ * IRQ per edge, and the timestamps do not include the interrupt latency.
+ * Without CONFIG_RP1_PIO, or if the PIO cannot be set up, the module falls
+ * back to the GPIO IRQ engine.
+ * sudo insmod rpi_fast_irq.ko capture_engine=1 pins=588 pio_batch=32
+ * capture_engine=2 requests no GPIO at all: a hard hrtimer on irq_cpu feeds
+ * synthetic edges through the ISR path (filter, ring, wakeup, trace) at a
+ * periodic, Poisson or burst schedule, changeable with
+ * RPI_FAST_IRQ_IOC_SET_SYNTH. Benchmarks then need no signal generator.
+ * sudo insmod rpi_fast_irq.ko capture_engine=2 synth_pattern=1 synth_rate_hz=100000
+ * sync_period_ms=N samples a (timestamp, CLOCK_TAI) pair into the header
+ * every N ms. With CLOCK_TAI disciplined by PTP (ptp4l + phc2sys) on every
+ * node, the library maps the timestamps of all nodes onto one timebase.
+ * sudo insmod rpi_fast_irq.ko sync_period_ms=1000
+ * ring_contiguous=1 allocates the ring as one physically contiguous block
+ * of high-order pages instead of vmalloc pages (for rings of megabytes).
+ * sudo insmod rpi_fast_irq.ko ring_size=262144 ring_contiguous=1
  * * 5. VERIFY INSTALLATION:
  * dmesg | tail -n 20
  * ls -l /dev/rp1_gpio_irq
@@ -55,107 +111,1676 @@
 #include <linux/cpumask.h>
 #include <linux/mm.h>
 #include <linux/vmalloc.h>
+#include <linux/irqflags.h>
+#include <linux/hrtimer.h>
+#include <linux/version.h>
+#include <linux/uaccess.h>
+#include <linux/bitops.h>
+#include <linux/mutex.h>
+#include <linux/math64.h>
+#include <linux/irq.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/delay.h>
+#include <linux/random.h>
+#include <linux/smp.h>
+#include <linux/workqueue.h>
+#if IS_ENABLED(CONFIG_RP1_PIO)
+#include <linux/gpio/driver.h>
+#include <linux/pio_rp1.h>
+#endif
+#ifdef CONFIG_ARM64
+#include <asm/arch_timer.h>
+#endif
+
+#include "rpi_fast_irq_uapi.h"
 
 #define DEVICE_NAME "rp1_gpio_irq"
 #define CLASS_NAME  "rp1_irq_class"
 
-#define GPIO_PIN 588 
-#define TARGET_CPU 3
+#define TARGET_CPU_DEFAULT 3
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Leonardo Lisa");
 MODULE_DESCRIPTION("Zero-Copy High-Performance GPIO IRQ Handler");
-MODULE_VERSION("2.0");
-
-// Shared payload structure
-struct GpioIrqEvent {
-    uint64_t timestamp_ns;   // u64 in C
-    uint32_t event_counter;  // u32 in C
-    //uint32_t pin_state;     // u32 in C
-    uint32_t _padding;       // Explicit padding to 16 bytes
-};
+MODULE_VERSION("2.2");
 
-#define KBUF_SIZE 256
+#define DRIVER_VERSION_MAJOR 2
+#define DRIVER_VERSION_MINOR 2
 
-// Mapped memory structure
-struct SharedRingBuffer {
-    u32 head;
-    u32 tail;
-    struct GpioIrqEvent events[KBUF_SIZE];
-};
+static int pins[MAX_PINS] = { 588 };
+static int num_pins = 1;
+module_param_array(pins, int, &num_pins, 0444);
+MODULE_PARM_DESC(pins, "Comma-separated list of logical GPIO numbers (default: 588, max 8)");
+
+#define RING_SIZE_DEFAULT 256
+#define RING_SIZE_MAX     (1u << 22)
+
+static unsigned int ring_size = RING_SIZE_DEFAULT;
+module_param(ring_size, uint, 0444);
+MODULE_PARM_DESC(ring_size, "Number of event slots in the ring, power of two (default: 256, max: 4194304)");
+
+static unsigned int overflow_policy = OVERFLOW_OVERWRITE;
+module_param(overflow_policy, uint, 0444);
+MODULE_PARM_DESC(overflow_policy, "Full ring behaviour: 0 = overwrite oldest (default), 1 = drop newest");
+
+static bool raw_ticks = false;
+module_param(raw_ticks, bool, 0444);
+MODULE_PARM_DESC(raw_ticks, "Timestamp with raw CNTVCT_EL0 ticks instead of CLOCK_MONOTONIC ns (arm64 only)");
+
+static unsigned int event_format = EVENT_FORMAT_LEGACY;
+module_param(event_format, uint, 0444);
+MODULE_PARM_DESC(event_format, "Ring record format: 0 = 16-byte GpioIrqEvent (default), 1 = 8-byte compact");
+
+static bool sample_level = false;
+module_param(sample_level, bool, 0444);
+MODULE_PARM_DESC(sample_level, "Read the pin level in the ISR and store it in the event flags");
+
+static unsigned int coalesce_events = 1;
+module_param(coalesce_events, uint, 0444);
+MODULE_PARM_DESC(coalesce_events, "Wake user space every N events (default: 1, every event)");
+
+static unsigned int coalesce_us = 100;
+module_param(coalesce_us, uint, 0444);
+MODULE_PARM_DESC(coalesce_us, "With coalesce_events > 1: max delay in us between the first pending event and the wakeup (default: 100)");
+
+static int irq_cpu = TARGET_CPU_DEFAULT;
+module_param(irq_cpu, int, 0444);
+MODULE_PARM_DESC(irq_cpu, "CPU the pin IRQs are bound to (hard affinity, default: 3, -1 = kernel default)");
+
+static bool trace_latency = false;
+module_param(trace_latency, bool, 0444);
+MODULE_PARM_DESC(trace_latency, "Record ISR entry, wakeup and exit times per event in a trace array");
+
+static unsigned int capture_engine = CAPTURE_ENGINE_ISR;
+module_param(capture_engine, uint, 0444);
+MODULE_PARM_DESC(capture_engine, "Edge acquisition: 0 = GPIO IRQ per edge (default), 1 = RP1 PIO hardware timestamps");
+
+#define PIO_BATCH_DEFAULT 32
+#define PIO_BATCH_MAX     4096
+
+static unsigned int pio_batch = PIO_BATCH_DEFAULT;
+module_param(pio_batch, uint, 0444);
+MODULE_PARM_DESC(pio_batch, "With capture_engine=1: edges per DMA transfer (default: 32, max: 4096)");
+
+static unsigned int pio_clk_hz = 200000000;
+module_param(pio_clk_hz, uint, 0444);
+MODULE_PARM_DESC(pio_clk_hz, "With capture_engine=1: RP1 PIO clock in Hz (default: 200000000)");
+
+// Initial schedule of the synthetic generator, see RPI_FAST_IRQ_IOC_SET_SYNTH
+static unsigned int synth_pattern = SYNTH_PATTERN_PERIODIC;
+module_param(synth_pattern, uint, 0444);
+MODULE_PARM_DESC(synth_pattern, "With capture_engine=2: 0 = periodic (default), 1 = Poisson, 2 = bursts");
+
+static unsigned int synth_rate_hz = 1000;
+module_param(synth_rate_hz, uint, 0444);
+MODULE_PARM_DESC(synth_rate_hz, "With capture_engine=2: tick rate in Hz (default: 1000, max: 1000000, 0 = stopped)");
+
+static unsigned int synth_burst_len = 10;
+module_param(synth_burst_len, uint, 0444);
+MODULE_PARM_DESC(synth_burst_len, "With synth_pattern=2: ticks per burst (default: 10)");
+
+static unsigned int synth_burst_gap_us = 1000;
+module_param(synth_burst_gap_us, uint, 0444);
+MODULE_PARM_DESC(synth_burst_gap_us, "With synth_pattern=2: pause after each burst in us (default: 1000)");
+
+static unsigned int synth_pin_mask = 0x1;
+module_param(synth_pin_mask, uint, 0444);
+MODULE_PARM_DESC(synth_pin_mask, "With capture_engine=2: pins that get an edge on every tick (default: 0x1)");
+
+static bool ring_contiguous = false;
+module_param(ring_contiguous, bool, 0444);
+MODULE_PARM_DESC(ring_contiguous, "Allocate the ring as one physically contiguous block (falls back to vmalloc when none is free)");
+
+#define SYNC_PERIOD_MAX_MS 60000
+
+static unsigned int sync_period_ms = 0;
+module_param(sync_period_ms, uint, 0444);
+MODULE_PARM_DESC(sync_period_ms, "Sample a (timestamp, CLOCK_TAI) pair into the header every N ms for cross-node alignment (default: 0 = off, max: 60000)");
+
+// SharedRingBuffer (rpi_fast_irq_uapi.h) fills the first page, the events follow
+#define RING_HEADER_SIZE PAGE_SIZE
 
 static int major_num;
 static struct class* irq_class = NULL;
 static struct device* irq_device = NULL;
 static struct cdev irq_cdev;
 
-static unsigned int irq_number;
-static u32 total_interrupts = 0;
+// Per-pin state, passed to the ISR as dev_id
+struct PinChannel {
+    int gpio;
+    unsigned int irq_number;
+    u16 index;
+    u32 total_interrupts;
+    u32 last_recorded;   // total_interrupts at the last record written to the ring
+    u32 stats_seq;       // Kernel-private seqlock counter of pin_stats[index]
+    u32 filtered_count;  // Edges rejected by the filter
+
+    // Filter configuration, written by the SET_FILTER ioctl and read with
+    // READ_ONCE() by the ISR. filter_reset asks the ISR to clear its state.
+    u32 edge;            // FILTER_EDGE_*
+    u64 deadtime_ns;     // As configured, reported by GET_FILTER
+    u64 deadtime;        // In timestamp units (ns or ticks)
+    u32 prescale;
+    bool filter_reset;
+
+    // Filter state, private to the ISR of this pin
+    bool has_last_edge;
+    u64 last_edge;       // Last edge that passed the deadtime check
+    u32 prescale_count;
+
+    bool enabled;        // IRQ enabled (RPI_FAST_IRQ_IOC_SET_ENABLED)
+    u64 last_timestamp;  // Last value published in pin_stats
+};
+
+static struct PinChannel channels[MAX_PINS];
 
 static struct SharedRingBuffer *shared_buf = NULL;
+static void *ring_events = NULL;
+static struct GpioIrqTraceRecord *ring_traces = NULL;   // NULL unless trace_latency
+static unsigned long ring_bytes;
+static bool ring_is_contiguous;      // shared_buf comes from ring_alloc_contiguous()
+static unsigned long trace_offset;   // 0 unless trace_latency
+static u32 event_size;
+
+// Live mappings of the ring: RECONFIGURE may only free an unmapped buffer
+static atomic_t ring_map_count = ATOMIC_INIT(0);
+
+// Kernel-private copy: the mapping is writable by user space, so the ISR
+// never indexes with values read back from the shared header.
+static u32 ring_mask;
+static u32 ring_high_water;
+static u64 ring_overruns;
+static u32 ring_seq;   // producer.seq
 static DECLARE_WAIT_QUEUE_HEAD(wq);
 
-static irqreturn_t gpio_isr(int irq, void *dev_id) {
-    u64 ts = ktime_get_ns();
-    //int state = gpio_get_value(GPIO_PIN);
+// Serializes the producers: every pin has its own ISR but all of them write
+// the same head. With all IRQs routed to irq_cpu the lock is uncontended.
+static DEFINE_RAW_SPINLOCK(ring_lock);
+
+static u32 clock_mode = CLOCK_MODE_NS;
+static u32 counter_freq = NSEC_PER_SEC;   // Kernel-private copy of counter_freq_hz
+
+// Serializes the control plane (filters, IRQ state, ring rebuilds) against
+// open() and mmap(), which must not see a ring being replaced
+static DEFINE_MUTEX(control_mutex);
+
+// Attached reader slots, modified under ring_lock. The ISR measures the
+// fill level against the slowest of them.
+static unsigned long reader_mask;
+
+// Interrupt moderation state, protected by ring_lock
+static u32 coalesce_pending;   // Events published since the last wakeup
+static struct hrtimer coalesce_timer;
+
+// CAPTURE_ENGINE_* actually running: capture_engine, unless the PIO engine
+// could not be started
+static u32 active_engine = CAPTURE_ENGINE_ISR;
+
+// Raw counter read: no clocksource indirection, no mult/shift conversion
+static __always_inline u64 read_timestamp(void) {
+#ifdef CONFIG_ARM64
+    if (clock_mode == CLOCK_MODE_TICKS)
+        return __arch_counter_get_cntvct();
+#endif
+    return ktime_get_ns();
+}
+
+static void publish_clock_info(void) {
+    shared_buf->meta.clock_mode = clock_mode;
+
+#ifdef CONFIG_ARM64
+    if (clock_mode == CLOCK_MODE_TICKS) {
+        unsigned long flags;
+        u64 ns_before, ns_after, ticks;
+
+        // Bracket the counter read with two clock reads, take the midpoint
+        local_irq_save(flags);
+        ns_before = ktime_get_ns();
+        ticks = __arch_counter_get_cntvct();
+        ns_after = ktime_get_ns();
+        local_irq_restore(flags);
+
+        counter_freq = arch_timer_get_cntfrq();
+        shared_buf->meta.counter_freq_hz = counter_freq;
+        shared_buf->meta.clock_ref_ticks = ticks;
+        shared_buf->meta.clock_ref_ns = ns_before + (ns_after - ns_before) / 2;
+        return;
+    }
+#endif
+
+    shared_buf->meta.counter_freq_hz = NSEC_PER_SEC;
+    shared_buf->meta.clock_ref_ticks = 0;
+    shared_buf->meta.clock_ref_ns = 0;
+}
+
+// Cross-node clock pairs (sync_period_ms). The state is kept here and
+// copied into every ring, so a RECONFIGURE does not lose the drift history.
+// Sampled by a delayed work under control_mutex: it never races a rebuild.
+#define SYNC_READS 3   // Bracketed reads per pair, the tightest one is kept
+
+static struct SharedRingClockSync sync_state;   // seq: kernel-private seqlock counter
+static struct delayed_work clock_sync_work;
+
+static void publish_clock_sync(void) {
+    struct SharedRingClockSync *cs = &shared_buf->clock_sync;
+
+    WRITE_ONCE(cs->seq, ++sync_state.seq);
+    smp_wmb();
+    WRITE_ONCE(cs->sync_clock, sync_state.sync_clock);
+    WRITE_ONCE(cs->period_ns, sync_state.period_ns);
+    WRITE_ONCE(cs->samples, sync_state.samples);
+    WRITE_ONCE(cs->prev_timestamp, sync_state.prev_timestamp);
+    WRITE_ONCE(cs->prev_sync_ns, sync_state.prev_sync_ns);
+    WRITE_ONCE(cs->last_timestamp, sync_state.last_timestamp);
+    WRITE_ONCE(cs->last_sync_ns, sync_state.last_sync_ns);
+    WRITE_ONCE(cs->uncertainty_ns, sync_state.uncertainty_ns);
+    smp_wmb();
+    WRITE_ONCE(cs->seq, ++sync_state.seq);
+}
+
+static void sample_clock_sync(void) {
+    u64 window = U64_MAX, ts = 0, tai = 0;
+    int i;
+
+    // Bracket the CLOCK_TAI read with two timestamp reads, take the
+    // midpoint of the narrowest bracket
+    for (i = 0; i < SYNC_READS; i++) {
+        unsigned long flags;
+        u64 before, after, now_tai;
+
+        local_irq_save(flags);
+        before = read_timestamp();
+        now_tai = ktime_get_clocktai_ns();
+        after = read_timestamp();
+        local_irq_restore(flags);
+
+        if (after - before < window) {
+            window = after - before;
+            ts = before + window / 2;
+            tai = now_tai;
+        }
+    }
+
+    sync_state.prev_timestamp = sync_state.last_timestamp;
+    sync_state.prev_sync_ns = sync_state.last_sync_ns;
+    sync_state.last_timestamp = ts;
+    sync_state.last_sync_ns = tai;
+    sync_state.uncertainty_ns = (u32)min_t(u64, mul_u64_u32_div(window / 2, NSEC_PER_SEC, counter_freq), U32_MAX);
+    sync_state.samples++;
+    publish_clock_sync();
+}
+
+static void clock_sync_fn(struct work_struct *work) {
+    mutex_lock(&control_mutex);
+    sample_clock_sync();
+    mutex_unlock(&control_mutex);
+    schedule_delayed_work(&clock_sync_work, msecs_to_jiffies(sync_period_ms));
+}
+
+// Moderation decision for a freshly published event, called with ring_lock
+// held. Returns true when user space must be woken now. A wakeup is forced
+// once the ring is half full, so moderation alone never causes overruns.
+static bool coalesce_ready(u32 fill) {
+    if (coalesce_events <= 1)
+        return true;
+
+    if (++coalesce_pending >= coalesce_events || fill >= ring_size / 2) {
+        coalesce_pending = 0;
+        // Never waits: a callback already running does a harmless extra wakeup
+        hrtimer_try_to_cancel(&coalesce_timer);
+        return true;
+    }
+
+    // First pending event: bound its latency by coalesce_us
+    if (coalesce_pending == 1)
+        hrtimer_start(&coalesce_timer, ns_to_ktime((u64)coalesce_us * NSEC_PER_USEC), HRTIMER_MODE_REL_PINNED_HARD);
+
+    return false;
+}
+
+// Fill level seen by the slowest attached reader, called with ring_lock
+// held. Tails come from user space, so each one is clamped.
+static u32 slowest_fill(u32 current_head) {
+    unsigned long mask = reader_mask;
+    u32 fill = 0;
+    unsigned int i;
+
+    for_each_set_bit(i, &mask, RING_MAX_READERS) {
+        u32 f = min_t(u32, current_head - smp_load_acquire(&shared_buf->readers[i].tail), ring_size);
+        if (f > fill)
+            fill = f;
+    }
+
+    return fill;
+}
+
+// Returns true when a wakeup was issued
+static bool wake_consumer(void) {
+    unsigned long mask;
+    unsigned int i;
+
+    // Pairs with the fence between clearing consumer_spinning and poll() in
+    // user space: either the consumer sees the new head, or we see the flag
+    // cleared and wake it up.
+    smp_mb();
+
+    // Wake up the readers sleeping on poll(), unless all of them are spinning
+    mask = READ_ONCE(reader_mask);
+    for_each_set_bit(i, &mask, RING_MAX_READERS) {
+        if (!READ_ONCE(shared_buf->readers[i].consumer_spinning)) {
+            wake_up_interruptible(&wq);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static enum hrtimer_restart coalesce_timer_fn(struct hrtimer *timer) {
+    unsigned long flags;
+
+    raw_spin_lock_irqsave(&ring_lock, flags);
+    coalesce_pending = 0;
+    raw_spin_unlock_irqrestore(&ring_lock, flags);
+
+    wake_consumer();
+    return HRTIMER_NORESTART;
+}
+
+// Publishes the pin counters for read-only monitors, called with ring_lock
+// held. The sequence is kept privately, the shared copy is write-only here.
+static void publish_pin_stats(struct PinChannel *ch, u64 ts) {
+    struct SharedRingPinStats *st = &shared_buf->pin_stats[ch->index];
+
+    WRITE_ONCE(st->seq, ++ch->stats_seq);
+    smp_wmb();
+    WRITE_ONCE(st->event_count, ch->total_interrupts);
+    WRITE_ONCE(st->recorded_count, ch->last_recorded);
+    WRITE_ONCE(st->filtered_count, ch->filtered_count);
+    WRITE_ONCE(st->last_timestamp, ts);
+    smp_wmb();
+    WRITE_ONCE(st->seq, ++ch->stats_seq);
+    ch->last_timestamp = ts;
+}
+
+// In-kernel filter, called first thing by the ISR of ch (an IRQ handler is
+// never re-entered for its own line, so the state needs no lock). Returns
+// true when the edge must be dropped.
+static bool filter_edge(struct PinChannel *ch, u64 ts) {
+    u64 deadtime = READ_ONCE(ch->deadtime);
+    u32 prescale = READ_ONCE(ch->prescale);
+
+    if (unlikely(READ_ONCE(ch->filter_reset))) {
+        WRITE_ONCE(ch->filter_reset, false);
+        ch->has_last_edge = false;
+        ch->prescale_count = 0;
+    }
+
+    // Non-paralyzable deadtime: rejected edges do not extend it
+    if (deadtime) {
+        if (ch->has_last_edge && ts - ch->last_edge < deadtime)
+            goto reject;
+        ch->last_edge = ts;
+        ch->has_last_edge = true;
+    }
+
+    if (prescale > 1 && ++ch->prescale_count < prescale)
+        goto reject;
+    ch->prescale_count = 0;
+    return false;
+
+reject:
+    ch->filtered_count++;
+    return true;
+}
+
+// Stage timestamps of the record at ring position pos, called after the
+// wakeup. seq goes last: readers match it against the position they read.
+static void publish_trace(u32 pos, u64 entry, u64 wakeup) {
+    struct GpioIrqTraceRecord *tr = &ring_traces[pos & ring_mask];
+
+    WRITE_ONCE(tr->isr_entry, entry);
+    WRITE_ONCE(tr->wakeup, wakeup);
+    WRITE_ONCE(tr->isr_exit, read_timestamp());
+    smp_store_release(&tr->seq, pos + 1);
+}
+
+// Writes one accepted edge of ch to the ring, called with ring_lock held by
+// the ISR or a PIO capture thread. Returns false when the edge was dropped
+// (full ring, OVERFLOW_DROP), otherwise its ring position in *pos and in
+// *wake whether user space must be woken now.
+static __always_inline bool record_event(struct PinChannel *ch, u64 ts, u8 flags, u32 *pos, bool *wake) {
     u32 current_head;
+    u32 fill;
+    u32 idx;
 
-    total_interrupts++;
+    ch->total_interrupts++;
 
     // Lock-free read of the current head
-    current_head = shared_buf->head;
+    current_head = shared_buf->producer.head;
+
+    // Progress of the slowest reader (0 with no reader attached)
+    fill = slowest_fill(current_head);
+
+    if (fill == ring_size) {
+        ring_overruns++;
+        WRITE_ONCE(shared_buf->producer.overruns, ring_overruns);
+
+        if (overflow_policy == OVERFLOW_DROP) {
+            // Respect the tails: the slowest reader is behind, so it is awake already
+            publish_pin_stats(ch, ts);
+            return false;
+        }
+    }
+
+    if (fill + 1 > ring_high_water) {
+        ring_high_water = min_t(u32, fill + 1, ring_size);
+        WRITE_ONCE(shared_buf->producer.high_water, ring_high_water);
+    }
     
     // Write payload
-    shared_buf->events[current_head % KBUF_SIZE].timestamp_ns = ts;
-    shared_buf->events[current_head % KBUF_SIZE].event_counter = total_interrupts;
-    //shared_buf->events[current_head % KBUF_SIZE].pin_state = state;
-    
-    // Memory barrier: ensure payload is written to memory before head is updated
-    smp_store_release(&shared_buf->head, current_head + 1);
+    idx = current_head & ring_mask;
+
+    if (event_format == EVENT_FORMAT_COMPACT) {
+        u32 seq_delta = min_t(u32, ch->total_interrupts - ch->last_recorded, COMPACT_SEQ_MAX);
+        struct GpioIrqCompactEvent *ev = (struct GpioIrqCompactEvent *)ring_events + idx;
+
+        ev->word = (ts & COMPACT_TS_MASK)
+                 | ((u64)ch->index << COMPACT_PIN_SHIFT)
+                 | ((u64)flags << COMPACT_FLAGS_SHIFT)
+                 | ((u64)seq_delta << COMPACT_SEQ_SHIFT);
+    } else {
+        struct GpioIrqEvent *ev = (struct GpioIrqEvent *)ring_events + idx;
+
+        ev->timestamp_ns = ts;
+        ev->event_counter = ch->total_interrupts;
+        ev->pin_index = ch->index;
+        ev->flags = flags;
+    }
 
-    // Wake up the user space thread sleeping on poll()
-    wake_up_interruptible(&wq);
+    ch->last_recorded = ch->total_interrupts;
+    WRITE_ONCE(shared_buf->producer.last_timestamp, ts);
 
+    // head and recorded_count of this pin change together inside the
+    // producer.seq window, so a reader never pairs the new head with the
+    // old count (see RpiFastIrq::snapshot_recorded_counts())
+    WRITE_ONCE(shared_buf->producer.seq, ++ring_seq);
+
+    // Memory barrier: ensure payload (and seq) is written to memory before head is updated
+    smp_store_release(&shared_buf->producer.head, current_head + 1);
+
+    publish_pin_stats(ch, ts);
+    smp_wmb();
+    WRITE_ONCE(shared_buf->producer.seq, ++ring_seq);
+
+    *pos = current_head;
+    *wake = coalesce_ready(min_t(u32, fill + 1, ring_size));
+    return true;
+}
+
+// Publishes an edge that passed the filter, from the GPIO ISR or the
+// synthetic generator: ring record, wakeup, trace record. The GPIO handler
+// is force-threaded (interrupts on) under threadirqs or PREEMPT_RT, and the
+// hard coalesce timer takes ring_lock too: hence irqsave, not a plain lock.
+static __always_inline void handle_edge(struct PinChannel *ch, u64 ts, u8 flags) {
+    unsigned long irq_flags;
+    u32 pos;
+    bool recorded;
+    bool wake;
+    u64 wake_ts = 0;
+
+    raw_spin_lock_irqsave(&ring_lock, irq_flags);
+    recorded = record_event(ch, ts, flags, &pos, &wake);
+    raw_spin_unlock_irqrestore(&ring_lock, irq_flags);
+
+    if (!recorded)
+        return;
+
+    if (ring_traces) {
+        if (wake) {
+            wake_ts = read_timestamp();
+            if (!wake_consumer())
+                wake_ts = 0;
+        }
+        publish_trace(pos, ts, wake_ts);
+        return;
+    }
+
+    if (wake)
+        wake_consumer();
+}
+
+static irqreturn_t gpio_isr(int irq, void *dev_id) {
+    u64 ts = read_timestamp();
+    struct PinChannel *ch = dev_id;
+    u8 flags = 0;
+
+    if (filter_edge(ch, ts))
+        return IRQ_HANDLED;
+
+    if (sample_level)
+        flags = EVENT_FLAG_LEVEL_VALID | (gpio_get_value(ch->gpio) ? EVENT_FLAG_LEVEL_HIGH : 0);
+
+    handle_edge(ch, ts, flags);
     return IRQ_HANDLED;
 }
 
+// Reader slot of an open file, -1 until it attached (or read-only)
+static int file_reader_slot(struct file *filep) {
+    return (int)(long)READ_ONCE(filep->private_data) - 1;
+}
+
+// Attaches filep as a reader, on its first writable mmap(). Control-only
+// opens (irqctl, set_synth(), ...) never get a slot, so slowest_fill()
+// only ever sees cursors that a consumer is moving. Called with
+// control_mutex held.
+static int attach_reader(struct file *filep) {
+    unsigned long flags;
+    unsigned int slot;
+
+    if (file_reader_slot(filep) >= 0)
+        return 0;
+
+    raw_spin_lock_irqsave(&ring_lock, flags);
+    slot = find_first_zero_bit(&reader_mask, RING_MAX_READERS);
+    if (slot < RING_MAX_READERS) {
+        // New readers start at the current head, with nothing pending
+        WRITE_ONCE(shared_buf->readers[slot].tail, shared_buf->producer.head);
+        WRITE_ONCE(shared_buf->readers[slot].consumer_spinning, 0);
+        set_bit(slot, &reader_mask);
+    }
+    raw_spin_unlock_irqrestore(&ring_lock, flags);
+
+    if (slot >= RING_MAX_READERS) {
+        pr_err("[%s] All %d reader slots are in use\n", DEVICE_NAME, RING_MAX_READERS);
+        return -EBUSY;
+    }
+
+    WRITE_ONCE(filep->private_data, (void *)(long)(slot + 1));
+    return 0;
+}
+
 static int dev_open(struct inode *inodep, struct file *filep) {
+    filep->private_data = NULL;
     return 0;
 }
 
 static int dev_release(struct inode *inodep, struct file *filep) {
+    int slot = file_reader_slot(filep);
+    unsigned long flags;
+
+    if (slot < 0)
+        return 0;
+
+    // Same locking as attach_reader(): the control plane (RECONFIGURE checks
+    // reader_mask) never sees a slot half released. A reader that exits
+    // while spinning must not leave the flag set for the next owner.
+    mutex_lock(&control_mutex);
+    raw_spin_lock_irqsave(&ring_lock, flags);
+    WRITE_ONCE(shared_buf->readers[slot].consumer_spinning, 0);
+    clear_bit(slot, &reader_mask);
+    raw_spin_unlock_irqrestore(&ring_lock, flags);
+    mutex_unlock(&control_mutex);
+
+    return 0;
+}
+
+// Hard affinity plus the matching hint, which keeps irqbalance away
+static void bind_irq(unsigned int irq) {
+    int result;
+
+    if (irq_cpu < 0)
+        return;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+    result = irq_set_affinity_and_hint(irq, cpumask_of(irq_cpu));
+#else
+    // Before 5.17 setting the hint also applies it as the affinity
+    result = irq_set_affinity_hint(irq, cpumask_of(irq_cpu));
+#endif
+    if (result)
+        pr_warn("[%s] Failed to bind IRQ %u to CPU %d (error %d)\n", DEVICE_NAME, irq, irq_cpu, result);
+}
+
+static void unbind_irq(unsigned int irq) {
+    if (irq_cpu < 0)
+        return;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+    irq_update_affinity_hint(irq, NULL);
+#else
+    irq_set_affinity_hint(irq, NULL);
+#endif
+}
+
+// Fresh counters and a pass-through filter, shared by both capture engines
+static void init_channel(struct PinChannel *ch, u16 index, int gpio) {
+    ch->gpio = gpio;
+    ch->index = index;
+    ch->total_interrupts = 0;
+    ch->last_recorded = 0;
+    ch->stats_seq = 0;
+    ch->filtered_count = 0;
+    ch->edge = FILTER_EDGE_RISING;
+    ch->deadtime_ns = 0;
+    ch->deadtime = 0;
+    ch->prescale = 0;
+    ch->filter_reset = false;
+    ch->has_last_edge = false;
+    ch->prescale_count = 0;
+    ch->enabled = true;
+    ch->last_timestamp = 0;
+}
+
+static int setup_pin(struct PinChannel *ch, u16 index, int gpio) {
+    int result;
+
+    init_channel(ch, index, gpio);
+
+    if (!gpio_is_valid(gpio)) {
+        pr_err("[%s] Invalid GPIO %d\n", DEVICE_NAME, gpio);
+        return -EINVAL;
+    }
+
+    result = gpio_request(gpio, "sysfs");
+    if (result < 0) {
+        pr_err("[%s] Failed to request GPIO %d\n", DEVICE_NAME, gpio);
+        return result;
+    }
+
+    gpio_direction_input(gpio);
+
+    ch->irq_number = gpio_to_irq(gpio);
+
+    result = request_irq(ch->irq_number, (irq_handler_t) gpio_isr, IRQF_TRIGGER_RISING, "rpi_fast_gpio_handler", ch);
+    if (result) {
+        gpio_free(gpio);
+        return result;
+    }
+
+    bind_irq(ch->irq_number);
+
+    pr_info("[%s] GPIO %d (IRQ %u) registered as pin index %u\n", DEVICE_NAME, gpio, ch->irq_number, index);
+    return 0;
+}
+
+static void release_pins(int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+        unbind_irq(channels[i].irq_number);
+        free_irq(channels[i].irq_number, &channels[i]);
+        gpio_free(channels[i].gpio);
+    }
+}
+
+// Requests count pins, all or none. On success they become the pins list.
+static int setup_pins(const int *list, int count) {
+    int result;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        result = setup_pin(&channels[i], i, list[i]);
+        if (result < 0) {
+            release_pins(i);
+            return result;
+        }
+    }
+
+    for (i = 0; i < count; i++)
+        pins[i] = list[i];
+    num_pins = count;
+    return 0;
+}
+
+// ============================================================================
+// RP1 PIO CAPTURE ENGINE (capture_engine=1)
+// ============================================================================
+// Each pin gets a PIO state machine running pio_ts_program: x counts down
+// once every PIO_CYCLES_PER_COUNT cycles whatever the pin does, and every
+// rising edge pushes x into the RX FIFO. The FIFO is drained by DMA into
+// batches of pio_batch words, and one capture thread per pin turns each
+// batch into ring records. The edge time is quantized to the loop length
+// (15 ns at 200 MHz) but no longer depends on when an interrupt is served.
+
+#define PIO_MAX_CHANNELS     4    // State machines of the RP1 PIO block
+#define PIO_CYCLES_PER_COUNT 3    // Length of every loop of pio_ts_program
+#define PIO_PUBLISH_CHUNK    64   // Records written per ring_lock hold
+#define RP1_BANK0_GPIOS      28   // GPIOs reachable by the PIO block
+
+#if IS_ENABLED(CONFIG_RP1_PIO)
+
+struct PioChannel {
+    struct PinChannel *ch;
+    unsigned int sm;
+    struct task_struct *thread;
+    u32 *batch;          // DMA destination, pio_batch words
+    u64 last_count;      // Unwrapped count of the newest capture
+};
+
+// pioasm source, 3 cycles and one x decrement per loop in every state:
+//     .wrap_target
+//     low:   jmp x-- low1       ; both outcomes continue at low1
+//     low1:  jmp pin rise
+//            jmp low
+//     rise:  in x, 32           ; autopush
+//     high:  jmp x-- high1
+//     high1: jmp pin high [1]
+//     .wrap
+static const u16 pio_ts_program_instructions[] = {
+    0x0041, // 0: jmp x--, 1
+    0x00c3, // 1: jmp pin, 3
+    0x0000, // 2: jmp 0
+    0x4020, // 3: in x, 32
+    0x0045, // 4: jmp x--, 5
+    0x01c4, // 5: jmp pin, 4 [1]
+};
+
+static const struct pio_program pio_ts_program = {
+    .instructions = pio_ts_program_instructions,
+    .length = ARRAY_SIZE(pio_ts_program_instructions),
+    .origin = -1,
+};
+
+#define PIO_TS_WRAP_TARGET 0
+#define PIO_TS_WRAP        5
+#define PIO_INSTR_MOV_X_NOT_NULL 0xa02b   // mov x, ~null
+#define PIO_INSTR_PUSH_NOBLOCK   0x8000   // push noblock
+
+static PIO pio_client;
+static struct PioChannel pio_channels[PIO_MAX_CHANNELS];
+static int pio_num_channels;
+static uint pio_program_offset;
+static u64 pio_anchor;     // Timestamp of the state machine start (count 0)
+static bool pio_stopping;
+
+// Offset of a logical GPIO in the RP1 bank, as seen by the PIO block
+static int rp1_gpio_offset(int gpio) {
+    struct gpio_desc *desc = gpio_is_valid(gpio) ? gpio_to_desc(gpio) : NULL;
+    struct gpio_chip *chip = desc ? gpiod_to_chip(desc) : NULL;
+
+    if (!chip || gpio - chip->base >= RP1_BANK0_GPIOS)
+        return -EINVAL;
+    return gpio - chip->base;
+}
+
+static u64 pio_count_to_timestamp(u64 count) {
+    // counter_freq is NSEC_PER_SEC unless raw_ticks
+    return pio_anchor + mul_u64_u32_div(count * PIO_CYCLES_PER_COUNT, counter_freq, pio_clk_hz);
+}
+
+static void pio_publish_batch(struct PioChannel *pc) {
+    struct PinChannel *ch = pc->ch;
+    unsigned long flags;
+    bool wake = false;
+    u32 i = 0;
+
+    while (i < pio_batch) {
+        u32 end = min_t(u32, i + PIO_PUBLISH_CHUNK, pio_batch);
+
+        raw_spin_lock_irqsave(&ring_lock, flags);
+        for (; i < end; i++) {
+            // ~x counts loops since the start. Captures are in time order,
+            // so the low 32 bits unwrap against the previous one: gaps
+            // longer than 2^32 counts (64 s at 200 MHz) are ambiguous.
+            u32 count = ~pc->batch[i];
+            u64 ts;
+            u32 pos;
+            bool event_wake;
+
+            pc->last_count += (u32)(count - (u32)pc->last_count);
+            ts = pio_count_to_timestamp(pc->last_count);
+
+            if (!READ_ONCE(ch->enabled) || filter_edge(ch, ts))
+                continue;
+            if (record_event(ch, ts, 0, &pos, &event_wake))
+                wake |= event_wake;
+        }
+        raw_spin_unlock_irqrestore(&ring_lock, flags);
+    }
+
+    if (wake)
+        wake_consumer();
+}
+
+static int pio_capture_thread(void *data) {
+    struct PioChannel *pc = data;
+    int result;
+
+    while (!kthread_should_stop()) {
+        // Blocks until the DMA transfer of a full batch has completed
+        result = pio_sm_xfer_data(pio_client, pc->sm, PIO_DIR_FROM_SM, pio_batch * sizeof(u32), pc->batch, 0, NULL, NULL);
+        if (READ_ONCE(pio_stopping))
+            break;
+        if (result < 0) {
+            pr_err_ratelimited("[%s] PIO transfer failed on pin index %u (error %d)\n", DEVICE_NAME, pc->ch->index, result);
+            msleep(100);
+            continue;
+        }
+        pio_publish_batch(pc);
+    }
+
+    // Park until pio_stop() collects the thread
+    set_current_state(TASK_INTERRUPTIBLE);
+    while (!kthread_should_stop()) {
+        schedule();
+        set_current_state(TASK_INTERRUPTIBLE);
+    }
+    __set_current_state(TASK_RUNNING);
+    return 0;
+}
+
+// Follows irq_cpu, like the IRQs of the ISR engine
+static void pio_bind_threads(void) {
+    int i;
+
+    for (i = 0; i < pio_num_channels; i++)
+        set_cpus_allowed_ptr(pio_channels[i].thread, irq_cpu >= 0 ? cpumask_of(irq_cpu) : cpu_possible_mask);
+}
+
+static void pio_stop(void) {
+    int i, j;
+
+    if (!pio_client)
+        return;
+
+    WRITE_ONCE(pio_stopping, true);
+
+    for (i = 0; i < pio_num_channels; i++) {
+        struct PioChannel *pc = &pio_channels[i];
+
+        pio_sm_set_enabled(pio_client, pc->sm, false);
+        if (pc->thread) {
+            // The thread waits for a full batch: complete it with dummy words
+            for (j = 0; j < pio_batch; j++)
+                pio_sm_exec(pio_client, pc->sm, PIO_INSTR_PUSH_NOBLOCK);
+            kthread_stop(pc->thread);
+            pc->thread = NULL;
+        }
+        pio_sm_unclaim(pio_client, pc->sm);
+        kfree(pc->batch);
+        pc->batch = NULL;
+    }
+    pio_num_channels = 0;
+
+    pio_remove_program(pio_client, &pio_ts_program, pio_program_offset);
+    pio_close(pio_client);
+    pio_client = NULL;
+}
+
+// Starts one state machine per pin of list, all or none. On success they
+// become the pins list.
+static int pio_start(const int *list, int count) {
+    u32 sm_mask = 0;
+    u64 before, after;
+    int result;
+    int i;
+
+    if (count > PIO_MAX_CHANNELS) {
+        pr_err("[%s] The PIO engine supports at most %d pins\n", DEVICE_NAME, PIO_MAX_CHANNELS);
+        return -EINVAL;
+    }
+
+    pio_client = pio_open();
+    if (IS_ERR(pio_client)) {
+        result = PTR_ERR(pio_client);
+        pio_client = NULL;
+        return result;
+    }
+
+    if (!pio_can_add_program(pio_client, &pio_ts_program)) {
+        pio_close(pio_client);
+        pio_client = NULL;
+        return -EBUSY;
+    }
+    pio_program_offset = pio_add_program(pio_client, &pio_ts_program);
+    WRITE_ONCE(pio_stopping, false);
+
+    for (i = 0; i < count; i++) {
+        struct PioChannel *pc = &pio_channels[i];
+        int offset = rp1_gpio_offset(list[i]);
+        pio_sm_config config;
+
+        if (offset < 0) {
+            pr_err("[%s] GPIO %d is not an RP1 bank 0 GPIO, the PIO cannot capture it\n", DEVICE_NAME, list[i]);
+            result = offset;
+            goto r_channels;
+        }
+
+        result = pio_claim_unused_sm(pio_client, false);
+        if (result < 0)
+            goto r_channels;
+        pc->sm = result;
+        pc->batch = kmalloc_array(pio_batch, sizeof(u32), GFP_KERNEL);
+        // Counted before any step that can fail, pio_stop() releases it
+        pio_num_channels = i + 1;
+        if (!pc->batch) {
+            result = -ENOMEM;
+            goto r_channels;
+        }
+
+        init_channel(&channels[i], i, list[i]);
+        pc->ch = &channels[i];
+        pc->last_count = 0;
+
+        // Two DMA buffers: one is filled while the thread publishes the other
+        result = pio_sm_config_xfer(pio_client, pc->sm, PIO_DIR_FROM_SM, pio_batch * sizeof(u32), 2);
+        if (result < 0)
+            goto r_channels;
+
+        pio_gpio_init(pio_client, offset);
+        pio_sm_set_consecutive_pindirs(pio_client, pc->sm, offset, 1, false);
+
+        config = pio_get_default_sm_config();
+        sm_config_set_wrap(&config, pio_program_offset + PIO_TS_WRAP_TARGET, pio_program_offset + PIO_TS_WRAP);
+        sm_config_set_in_pins(&config, offset);
+        sm_config_set_jmp_pin(&config, offset);
+        // Shift left, autopush every 32 bits: each "in x, 32" is one capture
+        sm_config_set_in_shift(&config, false, true, 32);
+        sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_RX);
+        pio_sm_init(pio_client, pc->sm, pio_program_offset, &config);
+        pio_sm_exec(pio_client, pc->sm, PIO_INSTR_MOV_X_NOT_NULL);
+
+        pc->thread = kthread_create(pio_capture_thread, pc, "rpi_fast_irq_pio/%d", i);
+        if (IS_ERR(pc->thread)) {
+            result = PTR_ERR(pc->thread);
+            pc->thread = NULL;
+            goto r_channels;
+        }
+        sched_set_fifo(pc->thread);
+        sm_mask |= 1u << pc->sm;
+
+        pr_info("[%s] GPIO %d (RP1 GPIO %d, PIO SM %u) registered as pin index %d\n", DEVICE_NAME, list[i], offset, pc->sm, i);
+    }
+
+    pio_bind_threads();
+    for (i = 0; i < count; i++)
+        wake_up_process(pio_channels[i].thread);
+
+    // Every count is relative to this start: the enable is a round trip to
+    // the RP1 firmware, so take the midpoint. The remaining error is a
+    // constant offset shared by all pins.
+    before = read_timestamp();
+    pio_enable_sm_mask_in_sync(pio_client, sm_mask);
+    after = read_timestamp();
+    pio_anchor = before + (after - before) / 2;
+
+    for (i = 0; i < count; i++)
+        pins[i] = list[i];
+    num_pins = count;
     return 0;
+
+r_channels:
+    pio_stop();
+    return result;
+}
+
+#else
+
+static void pio_bind_threads(void) {
+}
+
+static void pio_stop(void) {
+}
+
+static int pio_start(const int *list, int count) {
+    return -EOPNOTSUPP;
+}
+
+#endif // CONFIG_RP1_PIO
+
+// ============================================================================
+// SYNTHETIC GENERATOR (capture_engine=2)
+// ============================================================================
+// A hard hrtimer on irq_cpu stands in for the GPIO IRQ: every expiry takes a
+// timestamp and publishes an edge on each pin of the pin mask through
+// handle_edge(), exactly like gpio_isr(). No GPIO is requested, so throughput
+// and latency runs need no signal source and are reproducible on any Pi 5.
+
+static struct hrtimer synth_timer;
+// Written under control_mutex while the timer is stopped
+static struct RpiFastIrqSynth synth_config;
+static u64 synth_period_ns;
+static u32 synth_burst_pos;    // Ticks of the current burst, timer private
+static u64 synth_missed;       // Expiries skipped because the timer ran late
+
+// -ln(u / 2^32) in 16.16 fixed point, for exponential spacing: log2 of the
+// mantissa by repeated squaring, one fraction bit per step
+static u32 neg_ln_q16(u32 u) {
+    u32 int_part, frac = 0;
+    u64 m;
+    int i;
+
+    if (!u)
+        u = 1;
+    int_part = ilog2(u);
+    // Mantissa in [1, 2), 30 fraction bits: the square fits in 64 bits
+    m = int_part <= 30 ? (u64)u << (30 - int_part) : (u64)u >> (int_part - 30);
+    for (i = 15; i >= 0; i--) {
+        m = (m * m) >> 30;
+        if (m >= (2ULL << 30)) {
+            m >>= 1;
+            frac |= 1u << i;
+        }
+    }
+
+    // (32 - log2(u)) * ln(2), ln(2) = 45426 / 2^16
+    return (u32)((((32ULL << 16) - (((u64)int_part << 16) | frac)) * 45426) >> 16);
+}
+
+static u64 synth_next_interval(void) {
+    switch (synth_config.pattern) {
+    case SYNTH_PATTERN_POISSON:
+        return max_t(u64, 1, (synth_period_ns * neg_ln_q16(get_random_u32())) >> 16);
+    case SYNTH_PATTERN_BURST:
+        if (++synth_burst_pos >= synth_config.burst_len) {
+            synth_burst_pos = 0;
+            return (u64)synth_config.burst_gap_us * NSEC_PER_USEC;
+        }
+        return synth_period_ns;
+    default:
+        return synth_period_ns;
+    }
+}
+
+static enum hrtimer_restart synth_timer_fn(struct hrtimer *timer) {
+    u32 mask = synth_config.pin_mask;
+    u64 overruns;
+    int i;
+
+    for (i = 0; i < num_pins; i++) {
+        struct PinChannel *ch = &channels[i];
+        u64 ts;
+
+        if (!(mask & BIT(i)) || !READ_ONCE(ch->enabled))
+            continue;
+        ts = read_timestamp();
+        if (!filter_edge(ch, ts))
+            handle_edge(ch, ts, 0);
+    }
+
+    // Keeps the schedule: expiries that are already past are skipped, not
+    // delivered back to back
+    overruns = hrtimer_forward(timer, hrtimer_cb_get_time(timer), ns_to_ktime(synth_next_interval()));
+    if (overruns > 1)
+        WRITE_ONCE(synth_missed, synth_missed + overruns - 1);
+    return HRTIMER_RESTART;
+}
+
+static void synth_arm_local(void *unused) {
+    hrtimer_start(&synth_timer, ns_to_ktime(synth_period_ns), irq_cpu >= 0 ? HRTIMER_MODE_REL_PINNED_HARD : HRTIMER_MODE_REL_HARD);
+}
+
+// Starts the timer on irq_cpu, unless the generator is stopped (rate 0)
+static void synth_arm(void) {
+    if (!synth_config.rate_hz || !synth_config.pin_mask)
+        return;
+
+    synth_period_ns = div_u64(NSEC_PER_SEC, synth_config.rate_hz);
+    synth_burst_pos = 0;
+    if (irq_cpu >= 0)
+        smp_call_function_single(irq_cpu, synth_arm_local, NULL, 1);
+    else
+        synth_arm_local(NULL);
+}
+
+static void synth_disarm(void) {
+    hrtimer_cancel(&synth_timer);
+}
+
+static int validate_synth(const struct RpiFastIrqSynth *cfg) {
+    if (cfg->pattern > SYNTH_PATTERN_BURST || cfg->rate_hz > SYNTH_RATE_MAX)
+        return -EINVAL;
+    if (cfg->pattern == SYNTH_PATTERN_BURST && cfg->burst_len == 0)
+        return -EINVAL;
+    return 0;
+}
+
+// Virtual pins: the GPIO numbers of list only label the pin indices
+static int synth_start(const int *list, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+        init_channel(&channels[i], i, list[i]);
+        pins[i] = list[i];
+    }
+    num_pins = count;
+
+    synth_arm();
+    return 0;
+}
+
+static void synth_stop(void) {
+    synth_disarm();
+}
+
+// Called with control_mutex held
+static int set_synth(const struct RpiFastIrqSynth *cfg) {
+    int result = validate_synth(cfg);
+
+    if (result)
+        return result;
+    if (active_engine != CAPTURE_ENGINE_SYNTH)
+        return -EOPNOTSUPP;
+
+    synth_disarm();
+    synth_config = *cfg;
+    synth_config._reserved = 0;
+    synth_config.missed = 0;
+    synth_missed = 0;
+    synth_arm();
+    return 0;
+}
+
+// Called with control_mutex held
+static void get_synth(struct RpiFastIrqSynth *cfg) {
+    *cfg = synth_config;
+    cfg->missed = READ_ONCE(synth_missed);
+}
+
+// Stops the active engine: once this returns nothing writes to the ring.
+// The ISR engine either frees the pins or only masks their IRQs.
+static void stop_capture(bool release) {
+    int i;
+
+    switch (active_engine) {
+    case CAPTURE_ENGINE_PIO:
+        pio_stop();
+        break;
+    case CAPTURE_ENGINE_SYNTH:
+        synth_stop();
+        break;
+    default:
+        if (release) {
+            release_pins(num_pins);
+        } else {
+            // disable_irq() waits for a running ISR to finish
+            for (i = 0; i < num_pins; i++)
+                disable_irq(channels[i].irq_number);
+        }
+        break;
+    }
+}
+
+// Starts the active engine on list, all or none
+static int start_capture(const int *list, int count) {
+    switch (active_engine) {
+    case CAPTURE_ENGINE_PIO:
+        return pio_start(list, count);
+    case CAPTURE_ENGINE_SYNTH:
+        return synth_start(list, count);
+    default:
+        return setup_pins(list, count);
+    }
+}
+
+static u32 timestamp_resolution_ns(void) {
+    return active_engine == CAPTURE_ENGINE_PIO ? DIV_ROUND_UP(PIO_CYCLES_PER_COUNT * NSEC_PER_SEC, pio_clk_hz) : 0;
+}
+
+// Mapping size of a ring of size events, and where its trace array starts
+static unsigned long ring_layout(u32 size, unsigned long *trace_off) {
+    unsigned long bytes = RING_HEADER_SIZE + PAGE_ALIGN((unsigned long)size * event_size);
+
+    *trace_off = 0;
+    if (trace_latency) {
+        *trace_off = bytes;
+        bytes += PAGE_ALIGN((unsigned long)size * sizeof(struct GpioIrqTraceRecord));
+    }
+    return bytes;
+}
+
+// Ring memory, zeroed and mapped cacheable either way. vmalloc_user()
+// pages are mapped one by one at mmap time. With ring_contiguous the ring
+// is one block of high-order pages: the ISR writes it through the linear
+// map, and mmap maps it in a single remap_pfn_range(). Blocks above the
+// page allocator's maximum order fall back to vmalloc.
+static void *ring_alloc(unsigned long bytes, bool *contiguous) {
+    void *buf;
+
+    if (ring_contiguous) {
+        buf = alloc_pages_exact(bytes, GFP_KERNEL | __GFP_ZERO | __GFP_NOWARN);
+        if (buf) {
+            *contiguous = true;
+            return buf;
+        }
+        pr_warn("[%s] No contiguous block of %lu bytes, using vmalloc\n", DEVICE_NAME, bytes);
+    }
+    *contiguous = false;
+    return vmalloc_user(bytes);
+}
+
+static void ring_free(void *buf, unsigned long bytes, bool contiguous) {
+    if (!buf)
+        return;
+    if (contiguous)
+        free_pages_exact(buf, bytes);
+    else
+        vfree(buf);
+}
+
+// Makes a freshly allocated (zeroed) buffer the ring. Called at load time,
+// and by RECONFIGURE with every pin IRQ and the coalescing timer quiesced.
+static void install_ring(struct SharedRingBuffer *buf, bool contiguous, u32 size, unsigned long bytes, unsigned long trace_off) {
+    shared_buf = buf;
+    ring_is_contiguous = contiguous;
+    ring_size = size;
+    ring_mask = size - 1;
+    ring_bytes = bytes;
+    trace_offset = trace_off;
+    ring_events = (u8 *)buf + RING_HEADER_SIZE;
+    ring_traces = trace_off ? (struct GpioIrqTraceRecord *)((u8 *)buf + trace_off) : NULL;
+    ring_overruns = 0;
+    ring_high_water = 0;
+    ring_seq = 0;
+    coalesce_pending = 0;
+
+    buf->producer.head = 0;
+    buf->producer.seq = 0;
+    buf->meta.magic = RING_LAYOUT_MAGIC;
+    buf->meta.layout_version = RING_LAYOUT_VERSION;
+    buf->meta.num_pins = num_pins;
+    buf->meta.capacity = size;
+    buf->meta.mask = ring_mask;
+    buf->meta.events_offset = RING_HEADER_SIZE;
+    buf->meta.event_size = event_size;
+    buf->meta.event_format = event_format;
+    buf->meta.overflow_policy = overflow_policy;
+    buf->meta.trace_offset = trace_off;
+    buf->meta.trace_size = trace_off ? sizeof(struct GpioIrqTraceRecord) : 0;
+    buf->meta.irq_cpu = irq_cpu;
+    buf->meta.capture_engine = active_engine;
+    buf->meta.timestamp_resolution_ns = timestamp_resolution_ns();
+    publish_clock_info();
+    publish_clock_sync();
+}
+
+static void get_info(struct RpiFastIrqInfo *info) {
+    int i;
+
+    memset(info, 0, sizeof(*info));
+    info->layout_version = RING_LAYOUT_VERSION;
+    info->driver_version = (DRIVER_VERSION_MAJOR << 16) | DRIVER_VERSION_MINOR;
+    info->capacity = ring_size;
+    info->event_format = event_format;
+    info->num_pins = num_pins;
+    info->irq_cpu = irq_cpu;
+    info->flags = (clock_mode == CLOCK_MODE_TICKS ? INFO_FLAG_RAW_TICKS : 0) | (ring_traces ? INFO_FLAG_TRACE : 0)
+                | (active_engine == CAPTURE_ENGINE_PIO ? INFO_FLAG_PIO : 0)
+                | (active_engine == CAPTURE_ENGINE_SYNTH ? INFO_FLAG_SYNTH : 0)
+                | (sync_period_ms ? INFO_FLAG_CLOCK_SYNC : 0)
+                | (ring_is_contiguous ? INFO_FLAG_CONTIGUOUS : 0);
+    for (i = 0; i < num_pins; i++) {
+        info->pins[i] = pins[i];
+        if (channels[i].enabled)
+            info->enabled_mask |= 1u << i;
+    }
+}
+
+static void reset_counters(void) {
+    unsigned long flags;
+    int i;
+
+    raw_spin_lock_irqsave(&ring_lock, flags);
+    ring_overruns = 0;
+    ring_high_water = 0;
+    WRITE_ONCE(shared_buf->producer.overruns, 0);
+    WRITE_ONCE(shared_buf->producer.high_water, 0);
+    for (i = 0; i < num_pins; i++) {
+        channels[i].filtered_count = 0;
+        publish_pin_stats(&channels[i], channels[i].last_timestamp);
+    }
+    raw_spin_unlock_irqrestore(&ring_lock, flags);
 }
 
+// Called with control_mutex held
+static void set_enabled(u32 mask) {
+    int i;
+
+    for (i = 0; i < num_pins; i++) {
+        bool enable = mask & (1u << i);
+
+        if (enable == channels[i].enabled)
+            continue;
+        // disable_irq() waits for a running ISR of the pin to finish. The
+        // other engines keep running and skip the edges of the pin.
+        if (active_engine == CAPTURE_ENGINE_ISR) {
+            if (enable)
+                enable_irq(channels[i].irq_number);
+            else
+                disable_irq(channels[i].irq_number);
+        }
+        WRITE_ONCE(channels[i].enabled, enable);
+    }
+}
+
+// Called with control_mutex held
+static int set_irq_cpu(int cpu) {
+    int i;
+
+    if (cpu < -1 || (cpu >= 0 && (cpu >= nr_cpu_ids || !cpu_online(cpu))))
+        return -EINVAL;
+
+    switch (active_engine) {
+    case CAPTURE_ENGINE_PIO:
+        irq_cpu = cpu;
+        pio_bind_threads();
+        break;
+    case CAPTURE_ENGINE_SYNTH:
+        // The timer is pinned to the CPU that arms it
+        synth_disarm();
+        irq_cpu = cpu;
+        synth_arm();
+        break;
+    default:
+        for (i = 0; i < num_pins; i++)
+            unbind_irq(channels[i].irq_number);
+        irq_cpu = cpu;
+        for (i = 0; i < num_pins; i++)
+            bind_irq(channels[i].irq_number);
+        break;
+    }
+
+    WRITE_ONCE(shared_buf->meta.irq_cpu, irq_cpu);
+    return 0;
+}
+
+// Replaces the ring with an empty one, called with control_mutex held.
+// No reader may be attached and the old buffer must be unmapped; plain
+// control opens (like the caller's) do not count.
+static int reconfigure(const struct RpiFastIrqRingConfig *cfg) {
+    u32 size = cfg->ring_size ? cfg->ring_size : ring_size;
+    struct SharedRingBuffer *buf, *old_buf;
+    unsigned long bytes, old_bytes, trace_off, flags;
+    bool contiguous, old_contiguous;
+    int result = 0;
+    int i;
+
+    if (!is_power_of_2(size) || size > RING_SIZE_MAX || cfg->num_pins > MAX_PINS)
+        return -EINVAL;
+
+    if (reader_mask != 0 || atomic_read(&ring_map_count) != 0)
+        return -EBUSY;
+
+    bytes = ring_layout(size, &trace_off);
+    buf = ring_alloc(bytes, &contiguous);
+    if (!buf)
+        return -ENOMEM;
+
+    stop_capture(cfg->num_pins != 0);
+    hrtimer_cancel(&coalesce_timer);
+
+    old_buf = shared_buf;
+    old_bytes = ring_bytes;
+    old_contiguous = ring_is_contiguous;
+    raw_spin_lock_irqsave(&ring_lock, flags);
+    install_ring(buf, contiguous, size, bytes, trace_off);
+    raw_spin_unlock_irqrestore(&ring_lock, flags);
+
+    if (cfg->num_pins || active_engine != CAPTURE_ENGINE_ISR) {
+        int old_pins[MAX_PINS];
+        int old_count = num_pins;
+
+        // Only the ISR engine can be paused, the others restart even on the
+        // same pins
+        memcpy(old_pins, pins, sizeof(old_pins));
+        if (cfg->num_pins)
+            result = start_capture(cfg->pins, cfg->num_pins);
+        else
+            result = start_capture(old_pins, old_count);
+
+        if (result < 0 && cfg->num_pins) {
+            pr_err("[%s] New pin list rejected (error %d), restoring the previous one\n", DEVICE_NAME, result);
+            if (start_capture(old_pins, old_count) < 0) {
+                pr_err("[%s] Failed to restore the previous pins, no pin is active\n", DEVICE_NAME);
+                num_pins = 0;
+            }
+        } else if (result < 0) {
+            pr_err("[%s] Failed to restart the capture (error %d), no pin is active\n", DEVICE_NAME, result);
+            num_pins = 0;
+        }
+        buf->meta.num_pins = num_pins;
+    } else {
+        for (i = 0; i < num_pins; i++)
+            enable_irq(channels[i].irq_number);
+    }
+
+    // Fresh pin stats: attach_tail() seeds compact decoding from them
+    raw_spin_lock_irqsave(&ring_lock, flags);
+    for (i = 0; i < num_pins; i++)
+        publish_pin_stats(&channels[i], channels[i].last_timestamp);
+    raw_spin_unlock_irqrestore(&ring_lock, flags);
+
+    ring_free(old_buf, old_bytes, old_contiguous);
+    pr_info("[%s] Ring rebuilt: %u events, %d pins (%lu bytes mapped)\n", DEVICE_NAME, ring_size, num_pins, ring_bytes);
+    return result;
+}
+
+static const unsigned int filter_irq_types[] = {
+    [FILTER_EDGE_RISING]  = IRQ_TYPE_EDGE_RISING,
+    [FILTER_EDGE_FALLING] = IRQ_TYPE_EDGE_FALLING,
+    [FILTER_EDGE_BOTH]    = IRQ_TYPE_EDGE_BOTH,
+};
+
+static int set_filter(const struct RpiFastIrqFilter *filter) {
+    struct PinChannel *ch;
+    int result = 0;
+
+    if (filter->edge > FILTER_EDGE_BOTH)
+        return -EINVAL;
+
+    // num_pins and channels change under control_mutex (RECONFIGURE)
+    mutex_lock(&control_mutex);
+    if (filter->pin_index >= num_pins) {
+        result = -EINVAL;
+        goto out;
+    }
+    ch = &channels[filter->pin_index];
+
+    // pio_ts_program captures rising edges only
+    if (active_engine == CAPTURE_ENGINE_PIO && filter->edge != FILTER_EDGE_RISING) {
+        result = -EOPNOTSUPP;
+        goto out;
+    }
+
+    // Synthetic edges have no polarity, the setting is only stored
+    if (filter->edge != ch->edge && active_engine == CAPTURE_ENGINE_ISR) {
+        result = irq_set_irq_type(ch->irq_number, filter_irq_types[filter->edge]);
+        if (result) {
+            pr_err("[%s] Failed to set the trigger type of IRQ %u (error %d)\n", DEVICE_NAME, ch->irq_number, result);
+            goto out;
+        }
+    }
+
+    ch->edge = filter->edge;
+    ch->deadtime_ns = filter->deadtime_ns;
+    WRITE_ONCE(ch->deadtime, clock_mode == CLOCK_MODE_TICKS ? mul_u64_u32_div(filter->deadtime_ns, counter_freq, NSEC_PER_SEC) : filter->deadtime_ns);
+    WRITE_ONCE(ch->prescale, filter->prescale);
+    WRITE_ONCE(ch->filter_reset, true);
+
+out:
+    mutex_unlock(&control_mutex);
+    return result;
+}
+
+static int get_filter(struct RpiFastIrqFilter *filter) {
+    struct PinChannel *ch;
+
+    mutex_lock(&control_mutex);
+    if (filter->pin_index >= num_pins) {
+        mutex_unlock(&control_mutex);
+        return -EINVAL;
+    }
+    ch = &channels[filter->pin_index];
+    filter->edge = ch->edge;
+    filter->deadtime_ns = ch->deadtime_ns;
+    filter->prescale = ch->prescale;
+    filter->_reserved = 0;
+    mutex_unlock(&control_mutex);
+    return 0;
+}
+
+static long dev_ioctl(struct file *filep, unsigned int cmd, unsigned long arg) {
+    int slot = file_reader_slot(filep);
+    struct RpiFastIrqFilter filter;
+    struct RpiFastIrqInfo info;
+    struct RpiFastIrqRingConfig ring_config;
+    struct RpiFastIrqSynth synth;
+    u32 mask;
+    s32 cpu;
+    int result;
+
+    // Every other command changes what all readers see
+    if (!(filep->f_mode & FMODE_WRITE) && cmd != RPI_FAST_IRQ_IOC_GET_INFO && cmd != RPI_FAST_IRQ_IOC_GET_FILTER && cmd != RPI_FAST_IRQ_IOC_GET_SYNTH
+        && cmd != RPI_FAST_IRQ_IOC_READER_SLOT)
+        return -EPERM;
+
+    switch (cmd) {
+    case RPI_FAST_IRQ_IOC_READER_SLOT:
+        if (slot < 0)
+            return -ENODEV;
+        return put_user((u32)slot, (u32 __user *)arg);
+    case RPI_FAST_IRQ_IOC_SET_FILTER:
+        if (copy_from_user(&filter, (void __user *)arg, sizeof(filter)))
+            return -EFAULT;
+        return set_filter(&filter);
+    case RPI_FAST_IRQ_IOC_GET_FILTER:
+        if (copy_from_user(&filter, (void __user *)arg, sizeof(filter)))
+            return -EFAULT;
+        result = get_filter(&filter);
+        if (result)
+            return result;
+        if (copy_to_user((void __user *)arg, &filter, sizeof(filter)))
+            return -EFAULT;
+        return 0;
+    case RPI_FAST_IRQ_IOC_GET_INFO:
+        mutex_lock(&control_mutex);
+        get_info(&info);
+        mutex_unlock(&control_mutex);
+        if (copy_to_user((void __user *)arg, &info, sizeof(info)))
+            return -EFAULT;
+        return 0;
+    case RPI_FAST_IRQ_IOC_RESET_COUNTERS:
+        mutex_lock(&control_mutex);
+        reset_counters();
+        mutex_unlock(&control_mutex);
+        return 0;
+    case RPI_FAST_IRQ_IOC_SET_ENABLED:
+        if (get_user(mask, (u32 __user *)arg))
+            return -EFAULT;
+        mutex_lock(&control_mutex);
+        set_enabled(mask);
+        mutex_unlock(&control_mutex);
+        return 0;
+    case RPI_FAST_IRQ_IOC_SET_IRQ_CPU:
+        if (get_user(cpu, (s32 __user *)arg))
+            return -EFAULT;
+        mutex_lock(&control_mutex);
+        result = set_irq_cpu(cpu);
+        mutex_unlock(&control_mutex);
+        return result;
+    case RPI_FAST_IRQ_IOC_RECONFIGURE:
+        if (copy_from_user(&ring_config, (void __user *)arg, sizeof(ring_config)))
+            return -EFAULT;
+        mutex_lock(&control_mutex);
+        result = reconfigure(&ring_config);
+        mutex_unlock(&control_mutex);
+        return result;
+    case RPI_FAST_IRQ_IOC_SET_SYNTH:
+        if (copy_from_user(&synth, (void __user *)arg, sizeof(synth)))
+            return -EFAULT;
+        mutex_lock(&control_mutex);
+        result = set_synth(&synth);
+        mutex_unlock(&control_mutex);
+        return result;
+    case RPI_FAST_IRQ_IOC_GET_SYNTH:
+        mutex_lock(&control_mutex);
+        get_synth(&synth);
+        mutex_unlock(&control_mutex);
+        if (copy_to_user((void __user *)arg, &synth, sizeof(synth)))
+            return -EFAULT;
+        return 0;
+    default:
+        return -ENOTTY;
+    }
+}
+
+static void ring_vma_open(struct vm_area_struct *vma) {
+    atomic_inc(&ring_map_count);
+}
+
+static void ring_vma_close(struct vm_area_struct *vma) {
+    atomic_dec(&ring_map_count);
+}
+
+// Counts the mappings (including fork() copies) so RECONFIGURE can tell
+// whether the old buffer is still visible to user space
+static const struct vm_operations_struct ring_vm_ops = {
+    .open = ring_vma_open,
+    .close = ring_vma_close,
+};
+
 static int dev_mmap(struct file *filep, struct vm_area_struct *vma) {
     unsigned long size = vma->vm_end - vma->vm_start;
-    unsigned long expected_size = PAGE_ALIGN(sizeof(struct SharedRingBuffer));
+    unsigned long expected_size;
+    int result = 0;
+
+    mutex_lock(&control_mutex);
+    expected_size = ring_bytes;
 
     if (size > expected_size) {
         pr_err("[%s] mmap size %lu exceeds allocated size %lu\n", DEVICE_NAME, size, expected_size);
-        return -EINVAL;
+        result = -EINVAL;
+        goto out;
+    }
+
+    // Only a consumer maps the header writable, to move its tail; read-only
+    // mappings (monitors, the geometry probe of RpiFastIrq) stay observers.
+    // The slot is kept until the file is closed.
+    if ((vma->vm_flags & (VM_SHARED | VM_WRITE)) == (VM_SHARED | VM_WRITE)) {
+        result = attach_reader(filep);
+        if (result)
+            goto out;
     }
 
     // Removing pgprot_noncached ensures the mmap area inherits 
-    // the original cacheable attributes of vmalloc_user. Coherency between 
+    // the original cacheable attributes of the kernel buffer. Coherency between 
     // CPU 3 (LKM) and the C++ thread is guaranteed at the hardware level.
 
-    // Map the vmalloc area to user space
-    if (remap_vmalloc_range(vma, shared_buf, 0)) {
-        pr_err("[%s] mmap remap_vmalloc_range failed\n", DEVICE_NAME);
-        return -EAGAIN;
+    // Map the ring to user space; either way every page table entry is
+    // filled here, so user space takes no page fault on the ring
+    if (ring_is_contiguous)
+        result = remap_pfn_range(vma, vma->vm_start, virt_to_phys(shared_buf) >> PAGE_SHIFT, size, vma->vm_page_prot);
+    else
+        result = remap_vmalloc_range(vma, shared_buf, 0);
+    if (result) {
+        pr_err("[%s] mmap of the ring failed (error %d)\n", DEVICE_NAME, result);
+        result = -EAGAIN;
+        goto out;
     }
 
-    return 0;
+    vma->vm_ops = &ring_vm_ops;
+    ring_vma_open(vma);
+
+out:
+    mutex_unlock(&control_mutex);
+    return result;
 }
 
 static __poll_t dev_poll(struct file *filep, poll_table *wait) {
+    int slot = file_reader_slot(filep);
     __poll_t mask = 0;
-    
+
+    // Read-only observers have no cursor and are never readable
+    if (slot < 0)
+        return 0;
+
     poll_wait(filep, &wq, wait);
     
-    // Data is ready to read if head != tail using lock-free read
-    if (smp_load_acquire(&shared_buf->head) != smp_load_acquire(&shared_buf->tail)) {
+    // Data is ready to read if head != this reader's tail using lock-free read
+    if (smp_load_acquire(&shared_buf->producer.head) != smp_load_acquire(&shared_buf->readers[slot].tail)) {
         mask |= POLLIN | POLLRDNORM; 
     }
     
@@ -166,6 +1791,7 @@ static struct file_operations fops = {
     .open = dev_open,
     .mmap = dev_mmap,
     .poll = dev_poll,
+    .unlocked_ioctl = dev_ioctl,
     .release = dev_release,
     .owner = THIS_MODULE
 };
@@ -173,14 +1799,128 @@ static struct file_operations fops = {
 static int __init rpi_fast_irq_init(void) {
     int result;
     dev_t dev_num;
-    struct cpumask affinity_mask;
-    unsigned long buffer_size = PAGE_ALIGN(sizeof(struct SharedRingBuffer));
+    struct SharedRingBuffer *buf;
+    unsigned long bytes, trace_off;
+    bool contiguous;
 
-    shared_buf = vmalloc_user(buffer_size);
-    if (!shared_buf) return -ENOMEM;
-    
-    shared_buf->head = 0;
-    shared_buf->tail = 0;
+    if (overflow_policy > OVERFLOW_DROP) {
+        pr_err("[%s] Invalid overflow_policy %u\n", DEVICE_NAME, overflow_policy);
+        return -EINVAL;
+    }
+
+    if (!is_power_of_2(ring_size) || ring_size > RING_SIZE_MAX) {
+        pr_err("[%s] ring_size %u must be a power of two <= %u\n", DEVICE_NAME, ring_size, RING_SIZE_MAX);
+        return -EINVAL;
+    }
+
+    if (event_format > EVENT_FORMAT_COMPACT) {
+        pr_err("[%s] Invalid event_format %u\n", DEVICE_NAME, event_format);
+        return -EINVAL;
+    }
+
+    if (coalesce_events > 1 && coalesce_us == 0) {
+        pr_err("[%s] coalesce_us must be > 0 when coalesce_events > 1\n", DEVICE_NAME);
+        return -EINVAL;
+    }
+
+    if (irq_cpu >= 0 && (irq_cpu >= nr_cpu_ids || !cpu_online(irq_cpu))) {
+        pr_err("[%s] irq_cpu %d is not an online CPU\n", DEVICE_NAME, irq_cpu);
+        return -EINVAL;
+    }
+    if (irq_cpu < -1) {
+        pr_err("[%s] Invalid irq_cpu %d\n", DEVICE_NAME, irq_cpu);
+        return -EINVAL;
+    }
+
+    BUILD_BUG_ON(sizeof(struct SharedRingBuffer) > RING_HEADER_SIZE);
+    BUILD_BUG_ON(sizeof(struct SharedRingMeta) != 2 * RING_CACHELINE_SIZE);
+    BUILD_BUG_ON(offsetof(struct SharedRingBuffer, producer) != 2 * RING_CACHELINE_SIZE);
+    BUILD_BUG_ON(offsetof(struct SharedRingBuffer, pin_stats) != 3 * RING_CACHELINE_SIZE);
+    BUILD_BUG_ON(offsetof(struct SharedRingBuffer, readers) != 7 * RING_CACHELINE_SIZE);
+    BUILD_BUG_ON(sizeof(struct SharedRingConsumer) != RING_CACHELINE_SIZE);
+    BUILD_BUG_ON(sizeof(struct SharedRingPinStats) != 32);
+    BUILD_BUG_ON(sizeof(struct GpioIrqEvent) != 16);
+    BUILD_BUG_ON(sizeof(struct GpioIrqCompactEvent) != 8);
+    BUILD_BUG_ON(sizeof(struct GpioIrqTraceRecord) != 32);
+    BUILD_BUG_ON(sizeof(struct RpiFastIrqFilter) != 24);
+
+    BUILD_BUG_ON(sizeof(struct RpiFastIrqInfo) != 64);
+    BUILD_BUG_ON(sizeof(struct RpiFastIrqRingConfig) != 40);
+    BUILD_BUG_ON(sizeof(struct RpiFastIrqSynth) != 32);
+
+    if (raw_ticks) {
+#ifdef CONFIG_ARM64
+        clock_mode = CLOCK_MODE_TICKS;
+#else
+        pr_warn("[%s] raw_ticks is only supported on arm64, using ns timestamps\n", DEVICE_NAME);
+#endif
+    }
+
+    if (capture_engine > CAPTURE_ENGINE_SYNTH) {
+        pr_err("[%s] Invalid capture_engine %u\n", DEVICE_NAME, capture_engine);
+        return -EINVAL;
+    }
+
+    if (capture_engine == CAPTURE_ENGINE_PIO) {
+        if (pio_batch < 1 || pio_batch > PIO_BATCH_MAX || pio_clk_hz == 0) {
+            pr_err("[%s] pio_batch must be 1..%u and pio_clk_hz > 0\n", DEVICE_NAME, PIO_BATCH_MAX);
+            return -EINVAL;
+        }
+        // No ISR runs, so there is nothing to trace
+        if (trace_latency) {
+            pr_warn("[%s] trace_latency is not supported by the PIO engine, disabled\n", DEVICE_NAME);
+            trace_latency = false;
+        }
+    }
+
+    if (capture_engine == CAPTURE_ENGINE_SYNTH) {
+        synth_config.pattern = synth_pattern;
+        synth_config.rate_hz = synth_rate_hz;
+        synth_config.burst_len = synth_burst_len;
+        synth_config.burst_gap_us = synth_burst_gap_us;
+        synth_config.pin_mask = synth_pin_mask;
+        if (validate_synth(&synth_config)) {
+            pr_err("[%s] Invalid synthetic schedule: synth_pattern 0-2, synth_rate_hz <= %u, synth_burst_len > 0\n", DEVICE_NAME, SYNTH_RATE_MAX);
+            return -EINVAL;
+        }
+    }
+
+    if (sync_period_ms > SYNC_PERIOD_MAX_MS) {
+        pr_err("[%s] sync_period_ms must be 0..%u\n", DEVICE_NAME, SYNC_PERIOD_MAX_MS);
+        return -EINVAL;
+    }
+    if (sync_period_ms) {
+        sync_state.sync_clock = SYNC_CLOCK_TAI;
+        sync_state.period_ns = (u64)sync_period_ms * NSEC_PER_MSEC;
+    }
+    INIT_DELAYED_WORK(&clock_sync_work, clock_sync_fn);
+
+    event_size = (event_format == EVENT_FORMAT_COMPACT) ? sizeof(struct GpioIrqCompactEvent) : sizeof(struct GpioIrqEvent);
+    bytes = ring_layout(ring_size, &trace_off);
+
+    buf = ring_alloc(bytes, &contiguous);
+    if (!buf) return -ENOMEM;
+    install_ring(buf, contiguous, ring_size, bytes, trace_off);
+
+    pr_info("[%s] Ring of %u events (%lu bytes mapped%s)\n", DEVICE_NAME, ring_size, ring_bytes, contiguous ? ", contiguous" : "");
+
+    // Hard expiry: the callback runs in hardirq context on the ISR's CPU
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+    hrtimer_setup(&coalesce_timer, coalesce_timer_fn, CLOCK_MONOTONIC, HRTIMER_MODE_REL_PINNED_HARD);
+#else
+    hrtimer_init(&coalesce_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_PINNED_HARD);
+    coalesce_timer.function = coalesce_timer_fn;
+#endif
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+    hrtimer_setup(&synth_timer, synth_timer_fn, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+#else
+    hrtimer_init(&synth_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+    synth_timer.function = synth_timer_fn;
+#endif
+    if (coalesce_events > 1)
+        pr_info("[%s] Wakeup every %u events or %u us\n", DEVICE_NAME, coalesce_events, coalesce_us);
+    if (trace_latency)
+        pr_info("[%s] Latency tracing enabled\n", DEVICE_NAME);
 
     result = alloc_chrdev_region(&dev_num, 0, 1, DEVICE_NAME);
     major_num = MAJOR(dev_num);
@@ -193,51 +1933,60 @@ static int __init rpi_fast_irq_init(void) {
     irq_class = class_create(CLASS_NAME);
     irq_device = device_create(irq_class, NULL, dev_num, NULL, DEVICE_NAME);
 
-    if (!gpio_is_valid(GPIO_PIN)) goto r_device;
-
-    if (gpio_request(GPIO_PIN, "sysfs") < 0) {
-    pr_err("[%s] Failed to request GPIO %d\n", DEVICE_NAME, GPIO_PIN);
-    goto r_device;
+    if (num_pins < 1) {
+        pr_err("[%s] At least one pin is required\n", DEVICE_NAME);
+        goto r_device;
     }
 
-    gpio_direction_input(GPIO_PIN);
-    
-    irq_number = gpio_to_irq(GPIO_PIN);
+    active_engine = capture_engine;
+    result = start_capture(pins, num_pins);
+    if (result < 0 && active_engine == CAPTURE_ENGINE_PIO) {
+        pr_warn("[%s] PIO capture unavailable (error %d), using the GPIO IRQ engine\n", DEVICE_NAME, result);
+        active_engine = CAPTURE_ENGINE_ISR;
+        result = start_capture(pins, num_pins);
+    }
+    if (result < 0)
+        goto r_device;
 
-    result = request_irq(irq_number, (irq_handler_t) gpio_isr, IRQF_TRIGGER_RISING, "rpi_fast_gpio_handler", NULL);
-    if (result) goto r_gpio;
+    shared_buf->meta.capture_engine = active_engine;
+    shared_buf->meta.timestamp_resolution_ns = timestamp_resolution_ns();
+    if (active_engine == CAPTURE_ENGINE_PIO)
+        pr_info("[%s] PIO capture: %u edges per transfer, %u ns resolution\n", DEVICE_NAME, pio_batch, timestamp_resolution_ns());
+    if (active_engine == CAPTURE_ENGINE_SYNTH)
+        pr_info("[%s] Synthetic generator: pattern %u at %u Hz on pin mask 0x%x\n", DEVICE_NAME, synth_config.pattern, synth_config.rate_hz, synth_config.pin_mask);
 
-    cpumask_clear(&affinity_mask);
-    cpumask_set_cpu(TARGET_CPU, &affinity_mask);
-    irq_set_affinity_hint(irq_number, &affinity_mask);
+    // First pair right away, then every sync_period_ms
+    if (sync_period_ms) {
+        schedule_delayed_work(&clock_sync_work, 0);
+        pr_info("[%s] CLOCK_TAI pairs every %u ms\n", DEVICE_NAME, sync_period_ms);
+    }
 
     return 0;
 
-r_gpio:
-    gpio_free(GPIO_PIN);
 r_device:
+    hrtimer_cancel(&coalesce_timer);
     device_destroy(irq_class, dev_num);
     class_destroy(irq_class);
     cdev_del(&irq_cdev);
     unregister_chrdev_region(dev_num, 1);
 r_vmalloc:
-    vfree(shared_buf);
+    ring_free(shared_buf, ring_bytes, ring_is_contiguous);
     return -1;
 }
 
 static void __exit rpi_fast_irq_exit(void) {
     dev_t dev_num = MKDEV(major_num, 0);
 
-    irq_set_affinity_hint(irq_number, NULL);
-    free_irq(irq_number, NULL);
-    gpio_free(GPIO_PIN);
+    cancel_delayed_work_sync(&clock_sync_work);
+    stop_capture(true);
+    hrtimer_cancel(&coalesce_timer);
 
     device_destroy(irq_class, dev_num);
     class_destroy(irq_class);
     cdev_del(&irq_cdev);
     unregister_chrdev_region(dev_num, 1);
 
-    if (shared_buf) vfree(shared_buf);
+    ring_free(shared_buf, ring_bytes, ring_is_contiguous);
 }
 
 module_init(rpi_fast_irq_init);
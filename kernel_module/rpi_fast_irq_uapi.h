@@ -0,0 +1,290 @@
+/**
+ * @file rpi_fast_irq_uapi.h
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Memory layout of the /dev/rp1_gpio_irq mapping, shared by the kernel module and user space.
+ * @requirements C (kernel, gnu11) or C++17 (user space).
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Mapping layout:
+ *   page 0  SharedRingBuffer header, one cache line per writer:
+ *           line 0-1   meta      read-only, written when the ring is built
+ *           line 2     producer  written by the ISR (or PIO capture threads) only
+ *           line 3-6   pin_stats per-pin rate counters, written by the producer only
+ *           line 7-14  readers   one cursor line per attached reader, written
+ *                                by that reader only
+ *           line 15    clock_sync clock pairs for cross-node alignment, written
+ *                                by the module every sync_period_ms
+ *   page 1+ event array (events_offset), capacity records of event_size bytes
+ *   then    trace array (trace_offset), only with trace_latency=1: one
+ *           GpioIrqTraceRecord per event slot, same index
+ *
+ * Bump RING_LAYOUT_VERSION on any change to this file that moves a field.
+ */
+
+#ifndef RPI_FAST_IRQ_UAPI_H
+#define RPI_FAST_IRQ_UAPI_H
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#endif
+#include <linux/ioctl.h>
+
+#define RING_LAYOUT_MAGIC   0x51524946u  // "FIRQ" in little endian
+#define RING_LAYOUT_VERSION 10
+#define RING_CACHELINE_SIZE 64
+
+#define MAX_PINS 8
+
+// Concurrent readers of the broadcast ring: the first writable mmap() of an
+// open file claims one cursor slot. Control-only and read-only opens
+// (irqctl, monitors) claim none.
+#define RING_MAX_READERS 8
+
+// Ring record formats (event_format module parameter)
+#define EVENT_FORMAT_LEGACY  0   // GpioIrqEvent, 16 bytes
+#define EVENT_FORMAT_COMPACT 1   // GpioIrqCompactEvent, 8 bytes
+
+// Full ring behaviour (overflow_policy module parameter)
+#define OVERFLOW_OVERWRITE 0
+#define OVERFLOW_DROP      1
+
+// Timestamp unit (raw_ticks module parameter)
+#define CLOCK_MODE_NS    0
+#define CLOCK_MODE_TICKS 1
+
+// Acquisition engine (capture_engine module parameter)
+#define CAPTURE_ENGINE_ISR 0   // GPIO IRQ per edge, timestamped by the ISR
+#define CAPTURE_ENGINE_PIO 1   // RP1 PIO state machine per pin, timestamped in hardware
+#define CAPTURE_ENGINE_SYNTH 2 // hrtimer-driven synthetic edges, no GPIO or signal source
+
+#define EVENT_FLAG_LEVEL_VALID 0x1  // sample_level=1: LEVEL_HIGH holds the pin state
+#define EVENT_FLAG_LEVEL_HIGH  0x2
+
+// Shared payload structure
+struct GpioIrqEvent {
+    uint64_t timestamp_ns;   // CLOCK_MONOTONIC ns, raw counter ticks in CLOCK_MODE_TICKS
+    uint32_t event_counter;  // Counts interrupts of this pin
+    uint16_t pin_index;      // Index of the source pin in the "pins" module parameter
+    uint8_t flags;           // EVENT_FLAG_* bits
+    uint8_t _padding;        // Explicit padding to 16 bytes
+};
+
+// Compact payload: [47:0] timestamp (low 48 bits), [55:48] pin index,
+// [57:56] EVENT_FLAG_* bits, [63:58] events of this pin since its previous
+// record (1 = none lost, saturates at 63)
+struct GpioIrqCompactEvent {
+    uint64_t word;
+};
+
+#define COMPACT_TS_BITS     48
+#define COMPACT_TS_MASK     ((1ULL << COMPACT_TS_BITS) - 1)
+#define COMPACT_PIN_SHIFT   48
+#define COMPACT_FLAGS_SHIFT 56
+#define COMPACT_SEQ_SHIFT   58
+#define COMPACT_SEQ_MAX     63
+
+// Per-slot ISR timing written with trace_latency=1, in the timestamp clock
+// (clock_mode). The ISR writes it after publishing the event and stores seq
+// last, with release semantics: the record belongs to ring position p once
+// seq == p + 1. wakeup is 0 when this ISR did not wake a reader (coalesced,
+// or every reader was spinning).
+struct GpioIrqTraceRecord {
+    uint64_t isr_entry;        // First instruction of the ISR (the event timestamp)
+    uint64_t wakeup;           // Just before wake_up_interruptible()
+    uint64_t isr_exit;         // Just before returning IRQ_HANDLED
+    uint32_t seq;              // Ring position + 1 of the event this record describes
+    uint32_t _reserved;
+};
+
+// Lines 0-1: geometry and clock parameters, written when the ring is built
+// (load time or RPI_FAST_IRQ_IOC_RECONFIGURE); only irq_cpu changes later
+struct SharedRingMeta {
+    uint32_t magic;            // RING_LAYOUT_MAGIC
+    uint32_t layout_version;   // RING_LAYOUT_VERSION
+    uint32_t capacity;         // Number of event slots, power of two
+    uint32_t mask;             // capacity - 1
+    uint32_t events_offset;    // Byte offset of the event array from the start of the mapping
+    uint32_t event_size;       // Size of one record in bytes, depends on event_format
+    uint32_t event_format;     // EVENT_FORMAT_*
+    uint32_t overflow_policy;  // OVERFLOW_*
+    uint32_t clock_mode;       // CLOCK_MODE_*
+    uint32_t num_pins;         // Entries of the "pins" module parameter
+    uint64_t counter_freq_hz;  // Tick rate of the timestamps in CLOCK_MODE_TICKS
+    uint64_t clock_ref_ticks;  // Reference pair sampled at load time:
+    uint64_t clock_ref_ns;     // ns = ref_ns + (ticks - ref_ticks) * 1e9 / freq
+    uint32_t trace_offset;     // Byte offset of the GpioIrqTraceRecord array, 0 = tracing disabled
+    uint32_t trace_size;       // Size of one trace record in bytes
+    int32_t irq_cpu;           // CPU the pin IRQs (PIO: capture threads) are bound to, -1 = kernel default affinity
+    uint32_t capture_engine;   // CAPTURE_ENGINE_*, the engine actually running (after any fallback)
+    uint32_t timestamp_resolution_ns; // Quantization of the timestamps, 0 = clock resolution (ISR engine)
+} __attribute__((aligned(RING_CACHELINE_SIZE)));
+
+// Line 2: written by the ISR only
+struct SharedRingProducer {
+    uint32_t head;             // Free-running index of the next slot to write
+    uint32_t high_water;       // Highest fill level (head - tail) seen by the ISR
+    uint64_t overruns;         // Events overwritten unread or dropped because the ring was full
+    uint64_t last_timestamp;   // Full 64-bit timestamp of the newest record
+    uint32_t seq;              // Seqlock over head and every pin_stats recorded_count:
+                               // odd while a record is published
+} __attribute__((aligned(RING_CACHELINE_SIZE)));
+
+// One line per reader slot: written by its reader only, read by the ISR
+struct SharedRingConsumer {
+    uint32_t tail;             // Free-running index of the next slot to read
+    uint32_t consumer_spinning; // Set while the listener busy-polls head: no wakeup needed
+} __attribute__((aligned(RING_CACHELINE_SIZE)));
+
+// Lines 3-6: per-pin counters for rate monitors, which can map the header
+// page read-only and sample these without consuming the ring. Each entry is
+// a seqlock: read seq, the fields, then seq again, retry if odd or changed.
+struct SharedRingPinStats {
+    uint32_t seq;              // Odd while the ISR updates the entry
+    uint32_t event_count;      // Interrupts of this pin that passed the filter, recorded or not
+                               // (same counter as event_counter)
+    uint32_t recorded_count;   // event_count at the newest ring record of this pin
+                               // (consistent with head under producer.seq)
+    uint32_t filtered_count;   // Edges rejected by the in-kernel filter (see RpiFastIrqFilter),
+                               // published with the next accepted edge
+    uint64_t last_timestamp;   // Timestamp of the newest interrupt of this pin
+    uint64_t _reserved;
+};
+
+// Clock of the clock_sync pairs
+#define SYNC_CLOCK_NONE 0   // sync_period_ms=0: no pairs are sampled
+#define SYNC_CLOCK_TAI  1   // CLOCK_TAI ns, disciplined from the PTP hardware clock by
+                            // phc2sys (or by chrony/NTP): comparable across nodes
+
+// Line 15: pairs (ring timestamp, sync clock) sampled by the module every
+// sync_period_ms. The two latest pairs give the rate of the ring clock
+// against the sync clock, so readers can correct its drift linearly.
+// Seqlock like pin_stats.
+struct SharedRingClockSync {
+    uint32_t seq;              // Odd while the module updates the entry
+    uint32_t sync_clock;       // SYNC_CLOCK_*
+    uint64_t period_ns;        // Sampling period
+    uint64_t samples;          // Pairs taken since load (0 = none yet)
+    uint64_t prev_timestamp;   // Previous pair, valid when samples >= 2
+    uint64_t prev_sync_ns;
+    uint64_t last_timestamp;   // Latest pair: ring timestamp (ns or ticks, as the events)...
+    uint64_t last_sync_ns;     // ... and the sync clock at that instant
+    uint32_t uncertainty_ns;   // Half the read window of the latest pair
+    uint32_t _reserved;
+} __attribute__((aligned(RING_CACHELINE_SIZE)));
+
+// Mapped memory structure: this header fills the first page of the mapping
+struct SharedRingBuffer {
+    struct SharedRingMeta meta;
+    struct SharedRingProducer producer;
+    struct SharedRingPinStats pin_stats[MAX_PINS];
+    struct SharedRingConsumer readers[RING_MAX_READERS];
+    struct SharedRingClockSync clock_sync;
+};
+
+// ioctl interface of /dev/rp1_gpio_irq
+#define RPI_FAST_IRQ_IOC_MAGIC 'F'
+// Index of the reader slot claimed by this open file (-ENODEV until a writable mmap() attached it)
+#define RPI_FAST_IRQ_IOC_READER_SLOT _IOR(RPI_FAST_IRQ_IOC_MAGIC, 1, uint32_t)
+
+// Edge selection of the per-pin filter
+#define FILTER_EDGE_RISING  0   // Default, as requested at load time
+#define FILTER_EDGE_FALLING 1
+#define FILTER_EDGE_BOTH    2
+
+// Per-pin filter applied in the ISR before the ring is touched: rejected
+// edges are neither recorded nor counted in event_count, and wake nobody.
+// The filter is global: it applies to every reader of the ring.
+struct RpiFastIrqFilter {
+    uint32_t pin_index;        // Index in the "pins" module parameter
+    uint32_t edge;             // FILTER_EDGE_*, programmed into the IRQ trigger type
+    uint64_t deadtime_ns;      // Reject edges closer than this to the previous edge that
+                               // passed the deadtime check (non-paralyzable), 0 = off
+    uint32_t prescale;         // Keep 1 in N edges after the deadtime check, 0 or 1 = keep all
+    uint32_t _reserved;
+};
+
+// Writable opens only (-EPERM otherwise); resets the filter state of the pin
+#define RPI_FAST_IRQ_IOC_SET_FILTER _IOW(RPI_FAST_IRQ_IOC_MAGIC, 2, struct RpiFastIrqFilter)
+// pin_index in, the current filter of that pin out
+#define RPI_FAST_IRQ_IOC_GET_FILTER _IOWR(RPI_FAST_IRQ_IOC_MAGIC, 3, struct RpiFastIrqFilter)
+
+#define INFO_FLAG_RAW_TICKS 0x1   // Timestamps are CNTVCT ticks (raw_ticks=1)
+#define INFO_FLAG_TRACE     0x2   // Trace records are written (trace_latency=1)
+#define INFO_FLAG_PIO       0x4   // Edges are captured by the RP1 PIO engine (capture_engine=1)
+#define INFO_FLAG_SYNTH     0x8   // Edges come from the synthetic generator (capture_engine=2)
+#define INFO_FLAG_CLOCK_SYNC 0x10 // CLOCK_TAI pairs are sampled into clock_sync (sync_period_ms > 0)
+#define INFO_FLAG_CONTIGUOUS 0x20 // The ring is one physically contiguous block (ring_contiguous=1)
+
+// Module state, see RPI_FAST_IRQ_IOC_GET_INFO
+struct RpiFastIrqInfo {
+    uint32_t layout_version;   // RING_LAYOUT_VERSION of the module
+    uint32_t driver_version;   // (major << 16) | minor
+    uint32_t capacity;         // Current ring size in events
+    uint32_t event_format;     // EVENT_FORMAT_*
+    uint32_t num_pins;
+    int32_t irq_cpu;           // -1 = kernel default affinity
+    uint32_t enabled_mask;     // Bit i set: the IRQ of pin index i is enabled
+    uint32_t flags;            // INFO_FLAG_*
+    int32_t pins[MAX_PINS];    // Logical GPIO numbers, num_pins entries valid
+};
+
+// Synthetic generator schedules
+#define SYNTH_PATTERN_PERIODIC 0   // One tick every 1/rate_hz
+#define SYNTH_PATTERN_POISSON  1   // Exponential spacing with mean 1/rate_hz
+#define SYNTH_PATTERN_BURST    2   // burst_len ticks 1/rate_hz apart, then burst_gap_us of silence
+
+#define SYNTH_RATE_MAX 1000000     // 1 us minimum spacing
+
+// Synthetic generator of capture_engine=2. Each tick publishes one edge on
+// every pin of pin_mask through the same path as the GPIO ISR (filter,
+// ring, wakeup, trace).
+struct RpiFastIrqSynth {
+    uint32_t pattern;          // SYNTH_PATTERN_*
+    uint32_t rate_hz;          // Tick rate (Poisson: mean, burst: within a burst), 0 = stopped
+    uint32_t burst_len;        // SYNTH_PATTERN_BURST: ticks per burst
+    uint32_t burst_gap_us;     // SYNTH_PATTERN_BURST: pause after each burst
+    uint32_t pin_mask;         // Bit i: pin index i gets an edge on every tick
+    uint32_t _reserved;
+    uint64_t missed;           // GET_SYNTH only: ticks skipped because the timer ran late,
+                               // since the last SET_SYNTH
+};
+
+// Ring rebuild, see RPI_FAST_IRQ_IOC_RECONFIGURE
+struct RpiFastIrqRingConfig {
+    uint32_t ring_size;        // New capacity (power of two), 0 = keep the current one
+    uint32_t num_pins;         // New pin list length, 0 = keep the current pins
+    int32_t pins[MAX_PINS];    // Logical GPIO numbers when num_pins > 0
+};
+
+// Control plane. GET_INFO works on any open, the others need a writable one.
+#define RPI_FAST_IRQ_IOC_GET_INFO       _IOR(RPI_FAST_IRQ_IOC_MAGIC, 4, struct RpiFastIrqInfo)
+// Zeroes overruns, high_water and the per-pin filtered counts. Event counts
+// keep running: event_counter gaps stay meaningful for attached readers.
+#define RPI_FAST_IRQ_IOC_RESET_COUNTERS _IO(RPI_FAST_IRQ_IOC_MAGIC, 5)
+// Bit i enables the IRQ of pin index i, a cleared bit disables it
+#define RPI_FAST_IRQ_IOC_SET_ENABLED    _IOW(RPI_FAST_IRQ_IOC_MAGIC, 6, uint32_t)
+// Rebinds every pin IRQ (-1 = drop the binding, keep the current affinity)
+#define RPI_FAST_IRQ_IOC_SET_IRQ_CPU    _IOW(RPI_FAST_IRQ_IOC_MAGIC, 7, int32_t)
+// Replaces the ring with a new empty one, optionally resized and with a
+// new pin list. -EBUSY unless the caller is the only reader and nobody,
+// including this file, has the device mapped.
+#define RPI_FAST_IRQ_IOC_RECONFIGURE    _IOW(RPI_FAST_IRQ_IOC_MAGIC, 8, struct RpiFastIrqRingConfig)
+// Restarts the synthetic generator with a new schedule (-EOPNOTSUPP unless
+// capture_engine=2); GET_SYNTH works on any open
+#define RPI_FAST_IRQ_IOC_SET_SYNTH      _IOW(RPI_FAST_IRQ_IOC_MAGIC, 9, struct RpiFastIrqSynth)
+#define RPI_FAST_IRQ_IOC_GET_SYNTH      _IOR(RPI_FAST_IRQ_IOC_MAGIC, 10, struct RpiFastIrqSynth)
+
+#endif // RPI_FAST_IRQ_UAPI_H
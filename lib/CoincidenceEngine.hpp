@@ -0,0 +1,310 @@
+/**
+ * @file CoincidenceEngine.hpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Streaming coincidence stage: k-way merge of the per-pin streams, coincidence windows and vetoes, emission of the accepted groups only.
+ * @requirements C++17
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+#include "RpiFastIrq.hpp"
+
+struct CoincidenceConfig {
+    uint64_t window_ns = 100;        // A group spans at most this much after its first event
+    uint32_t input_mask = RpiFastIrq::ALL_PINS;  // Pins taking part in coincidences
+    uint32_t require_mask = 0;       // Every one of these pins must be in the group
+    uint32_t min_pins = 2;           // Distinct pins needed in the group
+    uint32_t veto_mask = 0;          // An event of these pins near the group rejects it
+    uint64_t veto_ns = 0;            // Veto range before the first and after the last group event
+    // The per-pin streams are merged assuming no pin is late by more than
+    // this against the others: 0 for the GPIO IRQ engine (one ring, one
+    // CPU), about one pio_batch worth of edges for the PIO engine
+    uint64_t max_skew_ns = 0;
+};
+
+// One accepted group, valid for the duration of the callback. Events are
+// in timestamp order.
+struct CoincidenceGroup {
+    const GpioIrqEvent* events;
+    size_t count;
+    uint32_t pin_mask;        // Pins present (bit = pin_index)
+    uint64_t first_timestamp;
+    uint64_t last_timestamp;
+    bool truncated;           // More than MAX_GROUP_EVENTS events, only the first ones kept
+};
+
+struct CoincidenceStats {
+    uint64_t events_in = 0;       // Accepted by push() (pin in input_mask or veto_mask)
+    uint64_t late_events = 0;     // Older than what the merge had already released, dropped
+    uint64_t forced_releases = 0; // Released before the skew bound because a pin queue was full
+    uint64_t groups = 0;          // Closed groups, accepted or not
+    uint64_t emitted = 0;         // Passed to the callback
+    uint64_t vetoed = 0;
+    uint64_t too_few_pins = 0;    // Rejected by min_pins or require_mask
+};
+
+// Events of each pin are queued in a fixed per-pin FIFO; the merge releases
+// the oldest head once every pin of input_mask and veto_mask has a queued
+// event, or once it is max_skew_ns older than the newest event seen (keep
+// the masks to the pins that exist when max_skew_ns is not 0). The merged stream opens a
+// group at an event and adds every event up to window_ns later. A closed
+// group waits until the stream has passed its veto range, then is emitted
+// when it has enough distinct pins and no veto. Everything lives in fixed
+// arrays; the only indirect call is the callback, once per emitted group.
+// Single-threaded: call push()/advance()/flush() from the listener thread.
+class CoincidenceEngine {
+public:
+    using GroupCallback = std::function<void(const CoincidenceGroup&)>;
+
+    static constexpr size_t QUEUE_CAPACITY = 1024;   // Per pin, power of two
+    static constexpr size_t MAX_GROUP_EVENTS = 64;
+    static constexpr size_t MAX_PENDING = 8;         // Closed groups waiting for their veto range
+    static constexpr uint32_t PIN_BITS = (1u << MAX_PINS) - 1;
+
+    CoincidenceEngine(const CoincidenceConfig& config, GroupCallback callback)
+        : m_config(config), m_callback(std::move(callback)) {
+        set_clock(RingClock());
+    }
+
+    // Timestamp unit of the events (RpiFastIrq::clock()); converts the ns
+    // settings. Call before the first event.
+    void set_clock(const RingClock& clock) {
+        auto to_units = [&clock](uint64_t ns) {
+            return clock.raw_ticks() ? static_cast<uint64_t>(static_cast<unsigned __int128>(ns) * clock.freq_hz / 1000000000u) : ns;
+        };
+        m_window = to_units(m_config.window_ns);
+        m_veto = to_units(m_config.veto_ns);
+        m_skew = to_units(m_config.max_skew_ns);
+    }
+
+    void push(const GpioIrqEvent& event) {
+        if (event.pin_index >= MAX_PINS) return;
+        const uint32_t bit = RpiFastIrq::pin_bit(event.pin_index);
+        if (!(bit & (m_config.input_mask | m_config.veto_mask))) return;
+        m_stats.events_in++;
+
+        PinQueue& queue = m_queues[event.pin_index];
+        // Make room by releasing without waiting for the other pins. The
+        // oldest head may belong to another pin: release until this queue
+        // itself has given up its own head.
+        while (queue.size() == QUEUE_CAPACITY) {
+            m_stats.forced_releases++;
+            release_one();
+        }
+        queue.events[queue.tail++ & (QUEUE_CAPACITY - 1)] = event;
+        m_nonempty |= bit;
+        if (event.timestamp_ns > m_newest) m_newest = event.timestamp_ns;
+
+        merge(m_newest);
+    }
+
+    // Batch form for RpiFastIrq::start_batch()
+    void push_batch(const GpioIrqEvent* first, size_t count) {
+        for (size_t i = 0; i < count; ++i) push(first[i]);
+    }
+
+    // Lets time pass without events (e.g. on a wakeup timeout): now, in the
+    // ring clock unit, is taken as a lower bound for every future event
+    // minus max_skew_ns, which releases queued events and closes groups.
+    void advance(uint64_t now) {
+        if (now > m_newest) m_newest = now;
+        merge(now);
+        const uint64_t horizon = (now > m_skew) ? now - m_skew : 0;
+        if (m_open.count && horizon > m_open.first + m_window) close_open();
+        decide_pending(horizon, false);
+    }
+
+    // End of input: releases and decides everything
+    void flush() {
+        while (release_one()) {}
+        if (m_open.count) close_open();
+        decide_pending(0, true);
+    }
+
+    const CoincidenceStats& stats() const { return m_stats; }
+
+private:
+    struct PinQueue {
+        GpioIrqEvent events[QUEUE_CAPACITY];
+        uint64_t head = 0;
+        uint64_t tail = 0;
+        size_t size() const { return static_cast<size_t>(tail - head); }
+    };
+
+    struct Group {
+        GpioIrqEvent events[MAX_GROUP_EVENTS];
+        size_t count = 0;
+        uint32_t pin_mask = 0;
+        uint64_t first = 0;
+        uint64_t last = 0;
+        bool truncated = false;
+        bool vetoed = false;
+    };
+
+    // Releases heads in timestamp order while the rule allows
+    void merge(uint64_t newest) {
+        while (true) {
+            int pin = oldest_head();
+            if (pin < 0) return;
+            const PinQueue& queue = m_queues[pin];
+            const uint64_t ts = queue.events[queue.head & (QUEUE_CAPACITY - 1)].timestamp_ns;
+            // A pin with nothing queued may still deliver an older event,
+            // until the skew bound has passed
+            const bool waiting = (m_config.input_mask | m_config.veto_mask) & PIN_BITS & ~m_nonempty;
+            if (waiting && ts + m_skew > newest) return;
+            release_one();
+        }
+    }
+
+    int oldest_head() const {
+        int best = -1;
+        uint64_t best_ts = 0;
+        for (uint32_t pins = m_nonempty; pins; pins &= pins - 1) {
+            const unsigned i = static_cast<unsigned>(__builtin_ctz(pins));
+            const PinQueue& queue = m_queues[i];
+            const uint64_t ts = queue.events[queue.head & (QUEUE_CAPACITY - 1)].timestamp_ns;
+            if (best < 0 || ts < best_ts) {
+                best = static_cast<int>(i);
+                best_ts = ts;
+            }
+        }
+        return best;
+    }
+
+    bool release_one() {
+        int pin = oldest_head();
+        if (pin < 0) return false;
+        PinQueue& queue = m_queues[pin];
+        const GpioIrqEvent& event = queue.events[queue.head++ & (QUEUE_CAPACITY - 1)];
+        if (queue.size() == 0) m_nonempty &= ~RpiFastIrq::pin_bit(static_cast<unsigned>(pin));
+        if (m_have_released && event.timestamp_ns < m_released) {
+            m_stats.late_events++;
+            return true;
+        }
+        m_released = event.timestamp_ns;
+        m_have_released = true;
+        process(event);
+        return true;
+    }
+
+    // Merged stream, in timestamp order
+    void process(const GpioIrqEvent& event) {
+        const uint64_t ts = event.timestamp_ns;
+        decide_pending(ts, false);
+
+        const uint32_t bit = RpiFastIrq::pin_bit(event.pin_index);
+        if (bit & m_config.veto_mask) {
+            m_last_veto = ts;
+            m_have_veto = true;
+            if (m_open.count && (ts <= m_open.first + m_window || ts <= m_open.last + m_veto)) m_open.vetoed = true;
+            for (size_t i = 0; i < m_pending_count; ++i) {
+                Group& group = m_pending[(m_pending_head + i) % MAX_PENDING];
+                if (ts <= group.last + m_veto) group.vetoed = true;
+            }
+            if (!(bit & m_config.input_mask)) return;
+        }
+
+        if (m_open.count && ts > m_open.first + m_window) close_open();
+        if (!m_open.count) {
+            m_open.pin_mask = 0;
+            m_open.first = ts;
+            m_open.truncated = false;
+            m_open.vetoed = m_have_veto && m_last_veto + m_veto >= ts;
+        }
+        if (m_open.count < MAX_GROUP_EVENTS) {
+            m_open.events[m_open.count++] = event;
+        } else {
+            m_open.truncated = true;
+        }
+        m_open.pin_mask |= bit;
+        m_open.last = ts;
+    }
+
+    void close_open() {
+        m_stats.groups++;
+        // Without vetoes there is nothing to wait for
+        if (!m_config.veto_mask) {
+            evaluate(m_open);
+            m_open.count = 0;
+            return;
+        }
+
+        if (m_pending_count == MAX_PENDING) decide_pending(0, true, 1);
+        Group& slot = m_pending[(m_pending_head + m_pending_count) % MAX_PENDING];
+        // Only the used part of the event array
+        for (size_t i = 0; i < m_open.count; ++i) slot.events[i] = m_open.events[i];
+        slot.count = m_open.count;
+        slot.pin_mask = m_open.pin_mask;
+        slot.first = m_open.first;
+        slot.last = m_open.last;
+        slot.truncated = m_open.truncated;
+        slot.vetoed = m_open.vetoed;
+        m_pending_count++;
+        m_open.count = 0;
+    }
+
+    // Decides the pending groups whose veto range ends before stream_time
+    // (all of them when force, at most limit)
+    void decide_pending(uint64_t stream_time, bool force, size_t limit = MAX_PENDING) {
+        while (m_pending_count && limit--) {
+            Group& group = m_pending[m_pending_head];
+            if (!force && stream_time <= group.last + m_veto) return;
+            m_pending_head = (m_pending_head + 1) % MAX_PENDING;
+            m_pending_count--;
+            evaluate(group);
+        }
+    }
+
+    void evaluate(const Group& group) {
+        if (group.vetoed) {
+            m_stats.vetoed++;
+            return;
+        }
+        const uint32_t signal_mask = group.pin_mask & m_config.input_mask;
+        if (static_cast<uint32_t>(__builtin_popcount(signal_mask)) < m_config.min_pins ||
+            (signal_mask & m_config.require_mask) != m_config.require_mask) {
+            m_stats.too_few_pins++;
+            return;
+        }
+        m_stats.emitted++;
+        CoincidenceGroup out{group.events, group.count, signal_mask, group.first, group.last, group.truncated};
+        m_callback(out);
+    }
+
+    CoincidenceConfig m_config;
+    GroupCallback m_callback;
+    uint64_t m_window = 0;
+    uint64_t m_veto = 0;
+    uint64_t m_skew = 0;
+
+    PinQueue m_queues[MAX_PINS];
+    uint32_t m_nonempty = 0;      // Bit i: pin i has queued events
+    uint64_t m_newest = 0;
+    uint64_t m_released = 0;
+    bool m_have_released = false;
+
+    Group m_open;
+    Group m_pending[MAX_PENDING];
+    size_t m_pending_head = 0;
+    size_t m_pending_count = 0;
+    uint64_t m_last_veto = 0;
+    bool m_have_veto = false;
+
+    CoincidenceStats m_stats;
+};
@@ -0,0 +1,203 @@
+/**
+ * @file JitterStats.hpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Online jitter and latency statistics: running moments plus a fixed-memory log histogram.
+ * @requirements C++17
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <limits>
+
+#include "RpiFastIrq.hpp"
+#include "Seqlock.hpp"
+
+// HDR-style histogram: values below 2^SUB_BITS get one bucket each, larger
+// ones 2^(SUB_BITS-1) buckets per power of two, i.e. a relative bucket
+// width of at most 1/1024 (1 us at a 1 ms period). Values from 2^MAX_BITS
+// (about 18 minutes in ns) share the last bucket; about 250 KB per histogram.
+// Single writer; counters are relaxed atomics so readers may copy them at
+// any time (each bucket is exact, the set is not a point-in-time cut).
+class LogHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 11;
+    static constexpr unsigned MAX_BITS = 40;
+    static constexpr unsigned SUB_COUNT = 1u << SUB_BITS;
+    static constexpr unsigned HALF_COUNT = SUB_COUNT / 2;
+    static constexpr unsigned BUCKETS = SUB_COUNT + (MAX_BITS - SUB_BITS) * HALF_COUNT;
+
+    LogHistogram() {
+        for (auto& bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    }
+
+    static unsigned bucket_index(uint64_t value) {
+        if (value < SUB_COUNT) return static_cast<unsigned>(value);
+        if (value >> MAX_BITS) return BUCKETS - 1;
+        unsigned exponent = 63u - static_cast<unsigned>(__builtin_clzll(value));
+        unsigned mantissa = static_cast<unsigned>(value >> (exponent - SUB_BITS + 1));  // [HALF_COUNT, SUB_COUNT)
+        return SUB_COUNT + (exponent - SUB_BITS) * HALF_COUNT + (mantissa - HALF_COUNT);
+    }
+
+    // Midpoint of a bucket, used as the value of its samples
+    static double bucket_value(unsigned index) {
+        if (index < SUB_COUNT) return index;
+        unsigned group = (index - SUB_COUNT) / HALF_COUNT;
+        uint64_t mantissa = HALF_COUNT + (index - SUB_COUNT) % HALF_COUNT;
+        unsigned shift = group + 1;
+        return static_cast<double>(mantissa << shift) + static_cast<double>(uint64_t(1) << shift) / 2.0;
+    }
+
+    // O(1), no RMW instruction: a plain load and store per sample
+    void record(uint64_t value) {
+        auto& bucket = m_buckets[bucket_index(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    uint64_t count(unsigned index) const { return m_buckets[index].load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_buckets[BUCKETS];
+};
+
+// Summary of one distribution, in ns
+struct DistributionSnapshot {
+    uint64_t count = 0;
+    double mean_ns = 0;
+    double stddev_ns = 0;
+    double min_ns = 0;
+    double max_ns = 0;
+    double p50_ns = 0;
+    double p99_ns = 0;
+    double p999_ns = 0;
+};
+
+// Running moments (Welford) and a LogHistogram of one value stream. The
+// writer updates a private copy and publishes it through a seqlock.
+class DistributionTracker {
+public:
+    void record(uint64_t value) {
+        double x = static_cast<double>(value);
+        m_moments.count++;
+        double delta = x - m_moments.mean;
+        m_moments.mean += delta / static_cast<double>(m_moments.count);
+        m_moments.m2 += delta * (x - m_moments.mean);
+        if (value < m_moments.min) m_moments.min = value;
+        if (value > m_moments.max) m_moments.max = value;
+
+        m_published.store(m_moments);
+        m_histogram.record(value);
+    }
+
+    // Any thread. Values are converted from the native unit with clock.
+    DistributionSnapshot snapshot(const RingClock& clock) const {
+        DistributionSnapshot snap;
+        Moments moments = m_published.load();
+        if (moments.count == 0) return snap;
+
+        const double ns_per_unit = clock.raw_ticks() ? 1e9 / static_cast<double>(clock.freq_hz) : 1.0;
+        snap.count = moments.count;
+        snap.mean_ns = moments.mean * ns_per_unit;
+        snap.stddev_ns = std::sqrt(moments.m2 / static_cast<double>(moments.count)) * ns_per_unit;
+        snap.min_ns = static_cast<double>(moments.min) * ns_per_unit;
+        snap.max_ns = static_cast<double>(moments.max) * ns_per_unit;
+
+        // Percentiles from the histogram, clamped to the exact extremes.
+        // Samples landing between the two passes are simply not reached.
+        uint64_t total = 0;
+        for (unsigned i = 0; i < LogHistogram::BUCKETS; ++i) total += m_histogram.count(i);
+
+        const double quantiles[3] = {0.50, 0.99, 0.999};
+        double* targets[3] = {&snap.p50_ns, &snap.p99_ns, &snap.p999_ns};
+        uint64_t cumulative = 0;
+        unsigned q = 0;
+        for (unsigned i = 0; i < LogHistogram::BUCKETS && q < 3; ++i) {
+            cumulative += m_histogram.count(i);
+            while (q < 3 && cumulative > 0 && static_cast<double>(cumulative) >= quantiles[q] * static_cast<double>(total)) {
+                double value = LogHistogram::bucket_value(i) * ns_per_unit;
+                if (value < snap.min_ns) value = snap.min_ns;
+                if (value > snap.max_ns) value = snap.max_ns;
+                *targets[q++] = value;
+            }
+        }
+
+        return snap;
+    }
+
+private:
+    struct Moments {
+        uint64_t count = 0;
+        double mean = 0;
+        double m2 = 0;
+        uint64_t min = std::numeric_limits<uint64_t>::max();
+        uint64_t max = 0;
+    };
+
+    Moments m_moments;
+    Seqlock<Moments> m_published{Moments{}};
+    LogHistogram m_histogram;
+};
+
+struct JitterSnapshot {
+    DistributionSnapshot deltas;    // Interval between consecutive events
+    DistributionSnapshot latency;   // ISR timestamp to on_event() call
+    uint64_t gaps;                  // Deltas skipped because event_counter jumped
+};
+
+// Online statistics of one event stream (typically one pin), updated on the
+// consumer thread in O(1) without allocation and read from any thread.
+class JitterStats {
+public:
+    // Optional clock used to convert snapshots; defaults to ns
+    void set_clock(const RingClock& clock) { m_clock = clock; }
+
+    // now: current time in the ring's clock unit (RingClock::now()). An
+    // interval across a gap in event_counter spans lost events and is
+    // counted as a gap instead of a delta.
+    void on_event(const GpioIrqEvent& event, uint64_t now) {
+        if (m_have_last) {
+            if (event.event_counter == m_last_counter + 1) {
+                m_deltas.record(event.timestamp_ns - m_last_timestamp);
+            } else {
+                m_gaps.store(m_gaps.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }
+        m_last_timestamp = event.timestamp_ns;
+        m_last_counter = event.event_counter;
+        m_have_last = true;
+
+        if (now >= event.timestamp_ns) m_latency.record(now - event.timestamp_ns);
+    }
+
+    JitterSnapshot snapshot() const {
+        JitterSnapshot snap;
+        snap.deltas = m_deltas.snapshot(m_clock);
+        snap.latency = m_latency.snapshot(m_clock);
+        snap.gaps = m_gaps.load(std::memory_order_relaxed);
+        return snap;
+    }
+
+private:
+    RingClock m_clock;
+    DistributionTracker m_deltas;
+    DistributionTracker m_latency;
+    std::atomic<uint64_t> m_gaps{0};
+    uint64_t m_last_timestamp = 0;
+    uint32_t m_last_counter = 0;
+    bool m_have_last = false;
+};
@@ -0,0 +1,197 @@
+/**
+ * @file RateEstimator.hpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Live event rate over a sliding window (1 ms to 60 s) and as an exponentially decayed average, published through a seqlock.
+ * @requirements C++17
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+#include "RpiFastIrq.hpp"
+#include "Seqlock.hpp"
+
+// Rates in Hz, computed for the time passed to snapshot()
+struct RateSnapshot {
+    uint64_t total = 0;           // Events seen since start
+    uint64_t last_timestamp = 0;  // Of the newest event, ring clock unit
+    uint64_t window_events = 0;   // Events inside the sliding window
+    double window_hz = 0;         // Sliding-window rate
+    double ewma_hz = 0;           // Exponentially decayed rate
+};
+
+// The window is split into BUCKETS time buckets. Per event the writer only
+// compares the timestamp with the current bucket end and bumps a counter;
+// at each bucket boundary it stores the (total, last timestamp) pair and
+// advances the EWMA with a precomputed decay factor, then publishes the
+// state once per batch. The window rate is the number of events since the
+// last boundary before the window divided by the event time they span, so a
+// steady stream reads exactly its rate (as the old counter/timestamp
+// delta did); a pause longer than one mean interval is added to the span,
+// so the rate decays to zero when the input stops. Readers on any thread
+// get a consistent state without locking, at any refresh rate.
+class RateEstimator {
+public:
+    static constexpr unsigned BUCKETS = 32;
+    static constexpr uint64_t MIN_WINDOW_NS = 1000000ull;       // 1 ms
+    static constexpr uint64_t MAX_WINDOW_NS = 60000000000ull;   // 60 s
+
+    // tau_ns: EWMA time constant, 0 = same as the window
+    explicit RateEstimator(uint64_t window_ns = 1000000000ull, uint64_t tau_ns = 0) {
+        if (window_ns < MIN_WINDOW_NS) window_ns = MIN_WINDOW_NS;
+        if (window_ns > MAX_WINDOW_NS) window_ns = MAX_WINDOW_NS;
+        m_window_ns = window_ns;
+        m_tau_ns = tau_ns ? tau_ns : window_ns;
+        set_clock(RingClock());
+    }
+
+    // Timestamp unit of the events (RpiFastIrq::clock()). Call before the
+    // first event: it resets the estimator.
+    void set_clock(const RingClock& clock) {
+        m_clock = clock;
+        m_units_per_sec = clock.raw_ticks() ? static_cast<double>(clock.freq_hz) : 1e9;
+        uint64_t window = static_cast<uint64_t>(static_cast<double>(m_window_ns) * m_units_per_sec / 1e9);
+        m_width = window / BUCKETS ? window / BUCKETS : 1;
+        m_decay = std::exp(-static_cast<double>(m_width) / (static_cast<double>(m_tau_ns) * m_units_per_sec / 1e9));
+        m_hz_per_count = m_units_per_sec / static_cast<double>(m_width);
+        m_state = State{};
+        m_bucket_end = 0;
+        m_published.store(m_state);
+    }
+
+    uint64_t window_ns() const { return m_window_ns; }
+    uint64_t tau_ns() const { return m_tau_ns; }
+
+    // Writer side (one thread). count events at timestamp; call publish()
+    // to make them visible.
+    void add(uint64_t timestamp, uint64_t count = 1) {
+        if (!m_state.started) start(timestamp);
+        if (timestamp >= m_bucket_end) roll(timestamp / m_width);
+        m_state.total += count;
+        if (timestamp > m_state.last_timestamp) m_state.last_timestamp = timestamp;
+    }
+
+    // Writer side: every event of the batch whose pin is in pin_mask, then
+    // one publish(). Fits RpiFastIrq::start_batch() directly.
+    void on_batch(const GpioIrqEvent* first, size_t count, uint32_t pin_mask = RpiFastIrq::ALL_PINS) {
+        for (size_t i = 0; i < count; ++i) {
+            const unsigned pin_index = first[i].pin_index;
+            if (pin_index < MAX_PINS && (pin_mask & RpiFastIrq::pin_bit(pin_index))) add(first[i].timestamp_ns);
+        }
+        publish();
+    }
+
+    void publish() { m_published.store(m_state); }
+
+    // Any thread. now: current time in the ring clock unit.
+    RateSnapshot snapshot(uint64_t now) const {
+        RateSnapshot snap;
+        State s = m_published.load();
+        if (!s.started) return snap;
+        snap.total = s.total;
+        snap.last_timestamp = s.last_timestamp;
+
+        uint64_t now_bucket = now / m_width;
+        if (now_bucket < s.head) now_bucket = s.head;
+
+        // EWMA up to the last completed bucket
+        snap.ewma_hz = s.ewma_hz;
+        if (now_bucket > s.head) {
+            snap.ewma_hz = m_decay * snap.ewma_hz + (1.0 - m_decay) * static_cast<double>(s.total - s.head_start_total) * m_hz_per_count;
+            snap.ewma_hz *= std::pow(m_decay, static_cast<double>(now_bucket - s.head - 1));
+        }
+
+        // Reference: the boundary just before the window. Without one (the
+        // window reaches back before the first event) the first event is
+        // the reference.
+        uint64_t events;
+        uint64_t ref_timestamp;
+        if (now_bucket >= s.first + BUCKETS) {
+            const uint64_t ref_bucket = now_bucket - BUCKETS;
+            if (ref_bucket >= s.head) return snap;  // Idle for a whole window
+            const Boundary& ref = s.boundaries[ref_bucket % BUCKETS];
+            events = s.total - ref.total;
+            ref_timestamp = ref.last_timestamp;
+        } else {
+            events = s.total - 1;
+            ref_timestamp = s.first_timestamp;
+        }
+        snap.window_events = events;
+        if (events == 0 || s.last_timestamp <= ref_timestamp) return snap;
+
+        double span = static_cast<double>(s.last_timestamp - ref_timestamp);
+        const double mean_interval = span / static_cast<double>(events);
+        const double idle = now > s.last_timestamp ? static_cast<double>(now - s.last_timestamp) : 0.0;
+        if (idle > mean_interval) span += idle - mean_interval;
+        snap.window_hz = static_cast<double>(events) * m_units_per_sec / span;
+        return snap;
+    }
+
+    RateSnapshot snapshot() const { return snapshot(m_clock.now()); }
+
+private:
+    struct Boundary {
+        uint64_t total;           // Events up to the end of the bucket
+        uint64_t last_timestamp;  // Newest event up to the end of the bucket
+    };
+
+    struct State {
+        bool started = false;
+        uint64_t first = 0;             // Bucket of the first event
+        uint64_t first_timestamp = 0;
+        uint64_t head = 0;              // Current bucket
+        uint64_t head_start_total = 0;  // total when the current bucket began
+        uint64_t total = 0;
+        uint64_t last_timestamp = 0;
+        double ewma_hz = 0;             // Up to the end of bucket head - 1
+        Boundary boundaries[BUCKETS] = {};  // Slot k % BUCKETS: end of bucket k
+    };
+
+    void start(uint64_t timestamp) {
+        m_state.started = true;
+        m_state.first = m_state.head = timestamp / m_width;
+        m_state.first_timestamp = m_state.last_timestamp = timestamp;
+        m_bucket_end = (m_state.head + 1) * m_width;
+    }
+
+    // Closes the current bucket and the empty ones up to new_head
+    void roll(uint64_t new_head) {
+        State& s = m_state;
+        s.ewma_hz = m_decay * s.ewma_hz + (1.0 - m_decay) * static_cast<double>(s.total - s.head_start_total) * m_hz_per_count;
+        const uint64_t empty = new_head - s.head - 1;
+        if (empty) s.ewma_hz *= std::pow(m_decay, static_cast<double>(empty));
+
+        const uint64_t closed = (empty + 1 < BUCKETS) ? empty + 1 : BUCKETS;
+        for (uint64_t k = new_head - closed; k < new_head; ++k) s.boundaries[k % BUCKETS] = Boundary{s.total, s.last_timestamp};
+
+        s.head = new_head;
+        s.head_start_total = s.total;
+        m_bucket_end = (new_head + 1) * m_width;
+    }
+
+    uint64_t m_window_ns;
+    uint64_t m_tau_ns;
+    RingClock m_clock;
+    double m_units_per_sec = 1e9;
+    uint64_t m_width = 1;          // Bucket width, ring clock unit
+    double m_decay = 0;            // EWMA factor per bucket
+    double m_hz_per_count = 0;     // One event in one bucket, in Hz
+    uint64_t m_bucket_end = 0;
+    State m_state;
+    Seqlock<State> m_published;
+};
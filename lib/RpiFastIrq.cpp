@@ -0,0 +1,741 @@
+/**
+ * @file RpiFastIrq.cpp
+ * @version 2.0.0
+ * @date 2026-02-25
+ * @author Leonardo Lisa
+ * @brief Implementation of the zero-copy, lock-free GPIO IRQ user-space library.
+ * @requirements C++17, Linux OS with root privileges for SCHED_FIFO.
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RpiFastIrq.hpp"
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <system_error>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sched.h>
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <pthread.h>
+#include <dirent.h>
+#include <alloca.h>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+
+// Busy-wait hint while head == expected. On AArch64 the exclusive load arms
+// the monitor on the head cache line, so WFE returns as soon as the ISR
+// stores head (or at the next timer event-stream tick at the latest).
+inline void spin_wait_hint(const uint32_t* head, uint32_t expected, bool use_wfe) {
+#if defined(__aarch64__)
+    if (use_wfe) {
+        uint32_t value;
+        __asm__ volatile("ldaxr %w0, [%1]" : "=&r"(value) : "r"(head) : "memory");
+        if (value == expected) __asm__ volatile("wfe" ::: "memory");
+    } else {
+        __asm__ volatile("yield" ::: "memory");
+    }
+#elif defined(__x86_64__) || defined(__i386__)
+    (void)head; (void)expected; (void)use_wfe;
+    __builtin_ia32_pause();
+#else
+    (void)head; (void)expected; (void)use_wfe;
+#endif
+}
+
+// Parses a kernel CPU list such as "2-3,5" (empty: no CPU)
+bool cpu_in_list(const std::string& list, int cpu) {
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || !std::isdigit(static_cast<unsigned char>(range[0]))) continue;
+        size_t dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last = (dash == std::string::npos) ? first : std::atoi(range.c_str() + dash + 1);
+        if (cpu >= first && cpu <= last) return true;
+    }
+    return false;
+}
+
+std::string read_first_line(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+bool process_running(const char* name) {
+    DIR* proc = ::opendir("/proc");
+    if (proc == nullptr) return false;
+
+    bool found = false;
+    while (struct dirent* entry = ::readdir(proc)) {
+        if (!std::isdigit(static_cast<unsigned char>(entry->d_name[0]))) continue;
+        if (read_first_line(std::string("/proc/") + entry->d_name + "/comm") == name) {
+            found = true;
+            break;
+        }
+    }
+    ::closedir(proc);
+    return found;
+}
+
+void print_isolation_report(const IsolationReport& report) {
+    std::string isolated = read_first_line("/sys/devices/system/cpu/isolated");
+    bool ok = true;
+
+    if (report.irq_cpu < 0) {
+        std::cerr << "\033[33m[RpiFastIrq] Warning: The module does not bind its IRQs (irq_cpu=-1).\033[0m\n";
+        ok = false;
+    } else {
+        if (!report.irq_cpu_isolated) {
+            std::cerr << "\033[33m[RpiFastIrq] Warning: IRQ CPU " << report.irq_cpu << " is not isolated (isolcpus: \""
+                      << isolated << "\").\033[0m\n";
+            ok = false;
+        }
+        if (!report.irq_affinity_ok) {
+            std::cerr << "\033[33m[RpiFastIrq] Warning: The pin IRQs are not (all) running on CPU " << report.irq_cpu << ".\033[0m\n";
+            ok = false;
+        }
+    }
+    if (report.listener_cpu >= 0 && !report.listener_cpu_isolated) {
+        std::cerr << "\033[33m[RpiFastIrq] Warning: Listener CPU " << report.listener_cpu << " is not isolated.\033[0m\n";
+        ok = false;
+    }
+    if (report.irqbalance_running) {
+        std::cerr << "\033[33m[RpiFastIrq] Warning: irqbalance is running and may move IRQs.\033[0m\n";
+        ok = false;
+    }
+
+    if (ok) {
+        const char* capture = (report.capture_engine == CAPTURE_ENGINE_ISR) ? "IRQs" : "capture";
+        std::cerr << "[RpiFastIrq] Isolation check passed: " << capture << " on CPU " << report.irq_cpu << ", listener on CPU "
+                  << report.listener_cpu << ", isolcpus: " << isolated << "\n";
+    }
+}
+
+inline uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Wakes a listener parked in WFE so stop() does not wait for the event stream
+inline void spin_wake_all() {
+#if defined(__aarch64__)
+    __asm__ volatile("sev" ::: "memory");
+#endif
+}
+
+} // namespace
+
+RpiFastIrq::RpiFastIrq(const std::string& device_path)
+    : m_device_path(device_path), m_fd(-1), m_shared_buf(nullptr), m_reader(nullptr), m_events(nullptr), m_compact_events(nullptr), m_event_format(EVENT_FORMAT_LEGACY), m_capture_engine(CAPTURE_ENGINE_ISR), m_timestamp_resolution_ns(0), m_mask(0), m_mmap_size(0), m_running(false), m_threadless(false), m_drain_tail(0), m_pin_mask(ALL_PINS), m_reader_skipped(0), m_sync_seq(0), m_traces(nullptr), m_poll_return_ns(0), m_last_timestamp(0), m_pin_counters{} {
+}
+
+RpiFastIrq::~RpiFastIrq() {
+    stop(); 
+}
+
+bool RpiFastIrq::start(IrqCallback user_callback) {
+    if (!prepare_start(-1)) return false;
+
+    m_callback = std::move(user_callback);
+    m_batch_callback = nullptr;
+    m_compact_batch_callback = nullptr;
+    m_trace_callback = nullptr;
+    launch_listener();
+
+    return true;
+}
+
+bool RpiFastIrq::start_batch(BatchCallback batch_callback) {
+    if (!prepare_start(EVENT_FORMAT_LEGACY)) return false;
+
+    m_callback = nullptr;
+    m_batch_callback = std::move(batch_callback);
+    m_compact_batch_callback = nullptr;
+    m_trace_callback = nullptr;
+    launch_listener();
+
+    return true;
+}
+
+bool RpiFastIrq::start_compact_batch(CompactBatchCallback batch_callback) {
+    if (!prepare_start(EVENT_FORMAT_COMPACT)) return false;
+
+    m_callback = nullptr;
+    m_batch_callback = nullptr;
+    m_compact_batch_callback = std::move(batch_callback);
+    m_trace_callback = nullptr;
+    launch_listener();
+
+    return true;
+}
+
+bool RpiFastIrq::start_traced(TraceCallback trace_callback) {
+    if (!prepare_start(-1)) return false;
+
+    if (m_traces == nullptr) {
+        std::cerr << "\033[31m[RpiFastIrq] Latency tracing is disabled. Load the module with trace_latency=1.\033[0m\n";
+        unmap_device();
+        return false;
+    }
+
+    m_callback = nullptr;
+    m_batch_callback = nullptr;
+    m_compact_batch_callback = nullptr;
+    m_trace_callback = std::move(trace_callback);
+    launch_listener();
+
+    return true;
+}
+
+bool RpiFastIrq::open() {
+    if (!prepare_start(-1)) return false;
+
+    m_drain_tail = attach_tail();
+    m_threadless = true;
+
+    return true;
+}
+
+bool RpiFastIrq::prepare_start(int required_format) {
+    if (m_running || m_threadless) {
+        std::cerr << "[RpiFastIrq] Already running.\n";
+        return false;
+    }
+
+    if (!map_device()) return false;
+
+    if (required_format >= 0 && m_event_format != static_cast<uint32_t>(required_format)) {
+        std::cerr << "\033[31m[RpiFastIrq] Ring uses event_format " << m_event_format
+                  << ", this start variant needs " << required_format << "\033[0m\n";
+        unmap_device();
+        return false;
+    }
+
+    return true;
+}
+
+bool RpiFastIrq::map_device() {
+    // O_RDWR required for PROT_WRITE mmap mapping
+    m_fd = ::open(m_device_path.c_str(), O_RDWR);
+    if (m_fd < 0) {
+        std::cerr << "\033[31m[RpiFastIrq] Failed to open device: " << m_device_path 
+                  << " Error: " << std::strerror(errno) << "\033[0m\n";
+        return false;
+    }
+
+    long page_size = ::sysconf(_SC_PAGESIZE);
+
+    // Map the header page alone first to learn the ring geometry
+    void* header = ::mmap(NULL, page_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (header == MAP_FAILED) {
+        std::cerr << "\033[31m[RpiFastIrq] mmap of header page failed: " << std::strerror(errno) << "\033[0m\n";
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    const SharedRingBuffer* geometry = static_cast<const SharedRingBuffer*>(header);
+    uint32_t magic = geometry->meta.magic;
+    uint32_t layout_version = geometry->meta.layout_version;
+    uint32_t capacity = geometry->meta.capacity;
+    uint32_t events_offset = geometry->meta.events_offset;
+    uint32_t event_size = geometry->meta.event_size;
+    uint32_t event_format = geometry->meta.event_format;
+    uint32_t trace_offset = geometry->meta.trace_offset;
+    uint32_t trace_size = geometry->meta.trace_size;
+    ::munmap(header, page_size);
+
+    if (magic != RING_LAYOUT_MAGIC || layout_version != RING_LAYOUT_VERSION) {
+        std::cerr << "\033[31m[RpiFastIrq] Ring layout version " << layout_version << " (magic 0x" << std::hex << magic << std::dec
+                  << ") does not match library layout version " << RING_LAYOUT_VERSION
+                  << ". Rebuild against the loaded kernel module.\033[0m\n";
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    size_t expected_size = (event_format == EVENT_FORMAT_COMPACT) ? sizeof(GpioIrqCompactEvent) : sizeof(GpioIrqEvent);
+
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 || event_format > EVENT_FORMAT_COMPACT || event_size != expected_size
+        || (trace_offset != 0 && trace_size != sizeof(GpioIrqTraceRecord))) {
+        std::cerr << "\033[31m[RpiFastIrq] Unsupported ring geometry (capacity " << capacity
+                  << ", event size " << event_size << "). Kernel module and library out of sync?\033[0m\n";
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    size_t ring_bytes = static_cast<size_t>(events_offset) + static_cast<size_t>(capacity) * event_size;
+    if (trace_offset != 0) {
+        ring_bytes = std::max(ring_bytes, static_cast<size_t>(trace_offset) + static_cast<size_t>(capacity) * trace_size);
+    }
+    m_mmap_size = (ring_bytes + page_size - 1) & ~(page_size - 1);
+
+    const int map_flags = MAP_SHARED | (m_config.prefault_ring ? MAP_POPULATE : 0);
+    m_shared_buf = static_cast<SharedRingBuffer*>(::mmap(NULL, m_mmap_size, PROT_READ | PROT_WRITE, map_flags, m_fd, 0));
+    if (m_shared_buf == MAP_FAILED) {
+        std::cerr << "\033[31m[RpiFastIrq] mmap failed: " << std::strerror(errno) << "\033[0m\n";
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    if (m_config.lock_memory && ::mlock(m_shared_buf, m_mmap_size) != 0) {
+        std::cerr << "\033[33m[RpiFastIrq] Warning: mlock of the ring failed: " << std::strerror(errno) << "\033[0m\n";
+    }
+    if (m_config.prefault_ring) prefault_mapping();
+
+    // The writable mapping attached this file as a reader: its own tail in the header page
+    uint32_t reader_slot = 0;
+    if (::ioctl(m_fd, RPI_FAST_IRQ_IOC_READER_SLOT, &reader_slot) < 0 || reader_slot >= RING_MAX_READERS) {
+        std::cerr << "\033[31m[RpiFastIrq] Failed to query the reader slot: " << std::strerror(errno) << "\033[0m\n";
+        ::munmap(m_shared_buf, m_mmap_size);
+        m_shared_buf = nullptr;
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    m_reader = &m_shared_buf->readers[reader_slot];
+
+    m_events = reinterpret_cast<GpioIrqEvent*>(reinterpret_cast<char*>(m_shared_buf) + events_offset);
+    m_compact_events = reinterpret_cast<GpioIrqCompactEvent*>(m_events);
+    m_traces = trace_offset ? reinterpret_cast<const GpioIrqTraceRecord*>(reinterpret_cast<char*>(m_shared_buf) + trace_offset) : nullptr;
+    m_event_format = event_format;
+    m_capture_engine = m_shared_buf->meta.capture_engine;
+    m_timestamp_resolution_ns = m_shared_buf->meta.timestamp_resolution_ns;
+    m_mask = capacity - 1;
+
+    m_clock = RingClock::from_meta(m_shared_buf->meta);
+    m_sync_clock = SyncClock();
+    m_sync_seq = 0;
+    refresh_sync_clock();
+
+    m_reader_skipped.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+// The module fills every page table entry of the ring at mmap time, and the
+// ring is kernel memory that is never swapped out. What is still cold on the
+// first lap are the TLB, the page-walk caches and the ring's cache lines:
+// one read per page moves those misses before the first event.
+void RpiFastIrq::prefault_mapping() {
+    const long page_size = ::sysconf(_SC_PAGESIZE);
+    const volatile char* base = reinterpret_cast<const volatile char*>(m_shared_buf);
+    char sink = 0;
+
+    for (size_t offset = 0; offset < m_mmap_size; offset += static_cast<size_t>(page_size)) sink ^= base[offset];
+    __asm__ __volatile__("" : : "r"(sink));
+}
+
+void RpiFastIrq::launch_listener() {
+    if (m_config.lock_memory && ::mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        std::cerr << "\033[33m[RpiFastIrq] Warning: mlockall failed: " << std::strerror(errno) << "\033[0m\n";
+    }
+
+    if (m_config.self_check) print_isolation_report(isolation_report());
+
+    m_running = true;
+    m_listener_thread = std::thread(&RpiFastIrq::listener_thread_func, this);
+}
+
+void RpiFastIrq::stop() {
+    if (m_threadless) {
+        m_threadless = false;
+        unmap_device();
+        return;
+    }
+
+    if (!m_running) return;
+
+    m_running = false;
+    spin_wake_all();
+
+    if (m_listener_thread.joinable()) {
+        m_listener_thread.join();
+    }
+
+    unmap_device();
+}
+
+void RpiFastIrq::unmap_device() {
+    if (m_shared_buf != nullptr && m_shared_buf != MAP_FAILED) {
+        ::munmap(m_shared_buf, m_mmap_size);
+        m_shared_buf = nullptr;
+        m_reader = nullptr;
+        m_events = nullptr;
+        m_compact_events = nullptr;
+        m_traces = nullptr;
+    }
+
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool RpiFastIrq::configure(const ListenerConfig& config) {
+    if (m_running || m_threadless) {
+        std::cerr << "[RpiFastIrq] configure() must be called before start().\n";
+        return false;
+    }
+
+    m_config = config;
+    return true;
+}
+
+void RpiFastIrq::subscribe(uint32_t pin_mask) {
+    m_pin_mask.store(pin_mask, std::memory_order_relaxed);
+}
+
+RingStats RpiFastIrq::ring_stats() const {
+    RingStats stats{};
+    if ((!m_running && !m_threadless) || m_shared_buf == nullptr) return stats;
+
+    stats.kernel_overruns = __atomic_load_n(&m_shared_buf->producer.overruns, __ATOMIC_RELAXED);
+    stats.reader_skipped = m_reader_skipped.load(std::memory_order_relaxed);
+    stats.high_water = __atomic_load_n(&m_shared_buf->producer.high_water, __ATOMIC_RELAXED);
+    stats.capacity = capacity();
+    stats.overflow_policy = m_shared_buf->meta.overflow_policy;
+    return stats;
+}
+
+bool RpiFastIrq::control(unsigned long request, void* arg, const char* what, bool writable) const {
+    int fd = m_fd;
+    if (fd < 0) {
+        fd = ::open(m_device_path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "\033[31m[RpiFastIrq] Failed to open device: " << m_device_path
+                      << " Error: " << std::strerror(errno) << "\033[0m\n";
+            return false;
+        }
+    }
+
+    bool ok = ::ioctl(fd, request, arg) == 0;
+    if (!ok) {
+        std::cerr << "\033[31m[RpiFastIrq] Failed to " << what << ": " << std::strerror(errno) << "\033[0m\n";
+    }
+
+    if (fd != m_fd) ::close(fd);
+    return ok;
+}
+
+bool RpiFastIrq::set_filter(const RpiFastIrqFilter& filter) {
+    RpiFastIrqFilter value = filter;
+    return control(RPI_FAST_IRQ_IOC_SET_FILTER, &value, "set the pin filter", true);
+}
+
+bool RpiFastIrq::get_filter(uint32_t pin_index, RpiFastIrqFilter& out) const {
+    RpiFastIrqFilter filter{};
+    filter.pin_index = pin_index;
+    if (!control(RPI_FAST_IRQ_IOC_GET_FILTER, &filter, "read the pin filter", false)) return false;
+    out = filter;
+    return true;
+}
+
+bool RpiFastIrq::query_info(RpiFastIrqInfo& out) const {
+    return control(RPI_FAST_IRQ_IOC_GET_INFO, &out, "query the module state", false);
+}
+
+bool RpiFastIrq::reset_counters() {
+    return control(RPI_FAST_IRQ_IOC_RESET_COUNTERS, nullptr, "reset the counters", true);
+}
+
+bool RpiFastIrq::set_enabled_pins(uint32_t pin_mask) {
+    return control(RPI_FAST_IRQ_IOC_SET_ENABLED, &pin_mask, "set the enabled pins", true);
+}
+
+bool RpiFastIrq::set_irq_cpu(int cpu) {
+    int32_t value = cpu;
+    return control(RPI_FAST_IRQ_IOC_SET_IRQ_CPU, &value, "move the IRQs", true);
+}
+
+bool RpiFastIrq::reconfigure_ring(uint32_t ring_size, const std::vector<int>& gpios) {
+    // Our own mapping would keep the old ring alive
+    if (m_running || m_threadless) {
+        std::cerr << "[RpiFastIrq] reconfigure_ring() must be called while stopped.\n";
+        return false;
+    }
+
+    if (gpios.size() > MAX_PINS) {
+        std::cerr << "\033[31m[RpiFastIrq] At most " << MAX_PINS << " pins are supported.\033[0m\n";
+        return false;
+    }
+
+    RpiFastIrqRingConfig config{};
+    config.ring_size = ring_size;
+    config.num_pins = static_cast<uint32_t>(gpios.size());
+    std::copy(gpios.begin(), gpios.end(), config.pins);
+    return control(RPI_FAST_IRQ_IOC_RECONFIGURE, &config, "rebuild the ring", true);
+}
+
+bool RpiFastIrq::set_synth(const RpiFastIrqSynth& synth) {
+    RpiFastIrqSynth value = synth;
+    return control(RPI_FAST_IRQ_IOC_SET_SYNTH, &value, "set the synthetic generator", true);
+}
+
+bool RpiFastIrq::get_synth(RpiFastIrqSynth& out) const {
+    return control(RPI_FAST_IRQ_IOC_GET_SYNTH, &out, "read the synthetic generator", false);
+}
+
+IsolationReport RpiFastIrq::isolation_report() const {
+    IsolationReport report{};
+    report.capture_engine = (m_shared_buf != nullptr) ? m_shared_buf->meta.capture_engine : CAPTURE_ENGINE_ISR;
+    report.irq_cpu = (m_shared_buf != nullptr) ? m_shared_buf->meta.irq_cpu : -1;
+    report.listener_cpu = m_config.cpu;
+
+    std::string isolated = read_first_line("/sys/devices/system/cpu/isolated");
+    report.irq_cpu_isolated = report.irq_cpu >= 0 && cpu_in_list(isolated, report.irq_cpu);
+    report.listener_cpu_isolated = report.listener_cpu >= 0 && cpu_in_list(isolated, report.listener_cpu);
+
+    // The module requests its IRQs as "rpi_fast_gpio_handler". The PIO and
+    // synthetic engines request none: their kthreads and hrtimer are placed
+    // on irq_cpu by the module itself, so there is nothing to look up.
+    report.irq_affinity_ok = true;
+    if (report.irq_cpu >= 0 && report.capture_engine == CAPTURE_ENGINE_ISR) {
+        std::ifstream interrupts("/proc/interrupts");
+        std::string line;
+        bool found = false;
+        while (std::getline(interrupts, line)) {
+            if (line.find("rpi_fast_gpio_handler") == std::string::npos) continue;
+            found = true;
+            std::string irq = std::to_string(std::atoi(line.c_str()));
+            std::string effective = read_first_line("/proc/irq/" + irq + "/effective_affinity_list");
+            if (effective.empty()) effective = read_first_line("/proc/irq/" + irq + "/smp_affinity_list");
+            if (effective != std::to_string(report.irq_cpu)) report.irq_affinity_ok = false;
+        }
+        if (!found) report.irq_affinity_ok = false;
+    }
+
+    report.irqbalance_running = process_running("irqbalance");
+    return report;
+}
+
+void RpiFastIrq::apply_thread_config() {
+    struct sched_param param;
+    param.sched_priority = 0;
+    if (m_config.sched_policy == SCHED_FIFO || m_config.sched_policy == SCHED_RR) {
+        int max_priority = sched_get_priority_max(m_config.sched_policy);
+        param.sched_priority = (m_config.priority < 0) ? max_priority : std::min(m_config.priority, max_priority);
+    }
+    if (sched_setscheduler(0, m_config.sched_policy, &param) == -1) {
+        std::cerr << "\033[33m[RpiFastIrq] Warning: Failed to set scheduling policy " << m_config.sched_policy
+                  << " priority " << param.sched_priority << ": " << std::strerror(errno) << ". RT policies require root privileges.\033[0m\n";
+    }
+
+    if (m_config.cpu >= 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(m_config.cpu, &cpuset);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+        if (err != 0) {
+            std::cerr << "\033[33m[RpiFastIrq] Warning: Failed to pin listener to CPU " << m_config.cpu
+                      << ": " << std::strerror(err) << "\033[0m\n";
+        }
+    }
+
+    // Touch the stack the loops will use, so the first events do not page fault
+    if (m_config.prefault_stack > 0) {
+        volatile char* stack = static_cast<volatile char*>(alloca(m_config.prefault_stack));
+        long page_size = ::sysconf(_SC_PAGESIZE);
+        for (size_t offset = 0; offset < m_config.prefault_stack; offset += page_size) stack[offset] = 0;
+    }
+}
+
+void RpiFastIrq::listener_thread_func() {
+    apply_thread_config();
+
+    uint32_t local_tail = attach_tail();
+
+    if (m_config.wait_mode == WaitMode::Poll) {
+        poll_loop(local_tail);
+    } else {
+        spin_loop(local_tail);
+    }
+}
+
+// Returns head, and fills counters[0, num_pins) with the recorded_count of
+// every pin at that head.
+// The ISR stores head and the pin stats of a record inside one producer.seq
+// window, so a stable even seq brackets a consistent snapshot; bracketing
+// with head alone could pair the new head with the previous count.
+uint32_t RpiFastIrq::snapshot_recorded_counts(uint32_t* counters) const {
+    uint32_t num_pins = std::min<uint32_t>(m_shared_buf->meta.num_pins, MAX_PINS);
+    uint32_t seq;
+    uint32_t head;
+
+    do {
+        seq = __atomic_load_n(&m_shared_buf->producer.seq, __ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&m_shared_buf->producer.head, __ATOMIC_RELAXED);
+        for (uint32_t i = 0; i < num_pins; ++i) {
+            counters[i] = __atomic_load_n(&m_shared_buf->pin_stats[i].recorded_count, __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1u) || seq != __atomic_load_n(&m_shared_buf->producer.seq, __ATOMIC_RELAXED));
+
+    return head;
+}
+
+uint32_t RpiFastIrq::attach_tail() {
+    // Compact records carry sequence deltas: seed the per-pin counters with
+    // recorded_count at the head we start from
+    std::fill(std::begin(m_pin_counters), std::end(m_pin_counters), 0u);
+    uint32_t local_tail = snapshot_recorded_counts(m_pin_counters);
+
+    // Synchronize local tail to prevent processing historical buffer data on startup
+    __atomic_store_n(&m_reader->tail, local_tail, __ATOMIC_RELEASE);
+
+    // Compact records carry 48-bit timestamps: extend them from the newest
+    // full timestamp, which precedes every record we are going to read
+    m_last_timestamp = __atomic_load_n(&m_shared_buf->producer.last_timestamp, __ATOMIC_RELAXED);
+
+    return local_tail;
+}
+
+// A lapped compact reader lost the sequence deltas of the skipped records,
+// so every event_counter rebuilt afterwards would be off. The pin stats give
+// recorded_count at a head snapshot; subtracting the deltas of the records
+// still in the ring gives the counters just before the new tail. Cold path,
+// one pass over the ring per lap.
+void RpiFastIrq::reseed_compact_counters(uint32_t& local_tail, uint32_t& current_head) {
+    std::fill(std::begin(m_pin_counters), std::end(m_pin_counters), 0u);
+    uint32_t head = snapshot_recorded_counts(m_pin_counters);
+
+    // The snapshot head may be further on: skip up to it as well
+    if (head - capacity() != local_tail) {
+        m_reader_skipped.fetch_add(head - capacity() - local_tail, std::memory_order_relaxed);
+    }
+    current_head = head;
+    local_tail = head - capacity();
+
+    for (uint32_t slot = local_tail; slot != head; ++slot) {
+        GpioIrqCompactEvent ev = m_compact_events[slot & m_mask];
+        m_pin_counters[compact_pin_index(ev)] -= compact_seq_delta(ev);
+    }
+}
+
+int RpiFastIrq::wait_readable(int timeout_ms) {
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN; 
+
+    int ret = ::poll(&pfd, 1, timeout_ms);
+
+    if (ret < 0) {
+        if (errno != EINTR) {
+            std::cerr << "\033[31m[RpiFastIrq] poll() error: " << std::strerror(errno) << "\033[0m\n";
+            return -1;
+        }
+        return 0;
+    }
+
+    return (ret > 0 && (pfd.revents & POLLIN)) ? 1 : 0;
+}
+
+void RpiFastIrq::poll_loop(uint32_t& local_tail) {
+    const int timeout_ms = 100; 
+
+    while (m_running) {
+        int ret = wait_readable(timeout_ms);
+        if (ret < 0) break;
+        if (ret > 0) {
+            if (m_trace_callback) m_poll_return_ns = monotonic_ns();
+            dispatch_pending(local_tail);
+        }
+    }
+}
+
+void RpiFastIrq::spin_loop(uint32_t& local_tail) {
+    using Clock = std::chrono::steady_clock;
+    const bool hybrid = (m_config.wait_mode == WaitMode::Hybrid);
+    const auto spin_window = std::chrono::microseconds(m_config.spin_us);
+    const int timeout_ms = 100;
+
+    auto last_event = Clock::now();
+
+    // Advertise that no wakeup is needed while we watch head ourselves
+    __atomic_store_n(&m_reader->consumer_spinning, 1u, __ATOMIC_RELAXED);
+
+    while (m_running) {
+        if (__atomic_load_n(&m_shared_buf->producer.head, __ATOMIC_ACQUIRE) != local_tail) {
+            if (m_trace_callback) m_poll_return_ns = monotonic_ns();
+            dispatch_pending(local_tail);
+            if (hybrid) last_event = Clock::now();
+            continue;
+        }
+
+        if (hybrid && Clock::now() - last_event > spin_window) {
+            // Spin window expired: go back to sleeping in poll(). The fence
+            // pairs with smp_mb() in the ISR, so an event published while the
+            // flag was still set is seen by poll() through head != tail.
+            __atomic_store_n(&m_reader->consumer_spinning, 0u, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+            while (m_running) {
+                int ret = wait_readable(timeout_ms);
+                if (ret < 0) return;
+                if (ret > 0) break;
+            }
+
+            __atomic_store_n(&m_reader->consumer_spinning, 1u, __ATOMIC_RELAXED);
+            last_event = Clock::now();
+            continue;
+        }
+
+        spin_wait_hint(&m_shared_buf->producer.head, local_tail, m_config.use_wfe);
+    }
+
+    __atomic_store_n(&m_reader->consumer_spinning, 0u, __ATOMIC_RELEASE);
+}
+
+void RpiFastIrq::dispatch_traced(uint32_t& local_tail, uint32_t current_head) {
+    uint32_t pin_mask = m_pin_mask.load(std::memory_order_relaxed);
+    LatencyTrace trace{};
+    trace.poll_return_ns = m_poll_return_ns;
+
+    while (local_tail != current_head) {
+        uint32_t slot = local_tail & m_mask;
+        GpioIrqEvent event_data = (m_event_format == EVENT_FORMAT_COMPACT) ? decode_compact(m_compact_events[slot]) : m_events[slot];
+
+        // 8-bit index in the record: bound it before shifting
+        if (event_data.pin_index < MAX_PINS && (pin_mask & pin_bit(event_data.pin_index))) {
+            // The ISR completes the record after the wakeup; seq tells
+            // whether it did so for this ring position already
+            const GpioIrqTraceRecord& record = m_traces[slot];
+            trace.kernel_valid = (__atomic_load_n(&record.seq, __ATOMIC_ACQUIRE) == local_tail + 1);
+            if (trace.kernel_valid) {
+                uint64_t wakeup = __atomic_load_n(&record.wakeup, __ATOMIC_RELAXED);
+                trace.isr_entry_ns = m_clock.to_ns(__atomic_load_n(&record.isr_entry, __ATOMIC_RELAXED));
+                trace.wakeup_ns = wakeup ? m_clock.to_ns(wakeup) : 0;
+                trace.isr_exit_ns = m_clock.to_ns(__atomic_load_n(&record.isr_exit, __ATOMIC_RELAXED));
+            } else {
+                trace.isr_entry_ns = m_clock.to_ns(event_data.timestamp_ns);
+                trace.wakeup_ns = 0;
+                trace.isr_exit_ns = 0;
+            }
+
+            trace.callback_ns = monotonic_ns();
+            m_trace_callback(event_data, trace);
+        }
+        local_tail++;
+    }
+}
@@ -0,0 +1,546 @@
+/**
+ * @file RpiFastIrq.hpp
+ * @version 2.0.0
+ * @date 2026-02-25
+ * @author Leonardo Lisa
+ * @brief Header for the zero-copy, lock-free GPIO IRQ user-space library.
+ * @requirements C++17
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include <sched.h>
+
+// Kernel/user-space ABI: GpioIrqEvent, GpioIrqCompactEvent, SharedRingBuffer
+#include "rpi_fast_irq_uapi.h"
+
+static_assert(sizeof(GpioIrqEvent) == 16, "GpioIrqEvent must match the kernel layout");
+static_assert(sizeof(GpioIrqCompactEvent) == 8, "GpioIrqCompactEvent must match the kernel layout");
+static_assert(sizeof(GpioIrqTraceRecord) == 32, "GpioIrqTraceRecord must match the kernel layout");
+static_assert(offsetof(SharedRingBuffer, producer) == 2 * RING_CACHELINE_SIZE, "producer line misplaced");
+static_assert(offsetof(SharedRingBuffer, pin_stats) == 3 * RING_CACHELINE_SIZE, "pin_stats lines misplaced");
+static_assert(offsetof(SharedRingBuffer, readers) == 7 * RING_CACHELINE_SIZE, "reader lines misplaced");
+static_assert(offsetof(SharedRingBuffer, clock_sync) == 15 * RING_CACHELINE_SIZE, "clock_sync line misplaced");
+
+inline uint64_t compact_timestamp(GpioIrqCompactEvent ev) { return ev.word & COMPACT_TS_MASK; }
+inline uint16_t compact_pin_index(GpioIrqCompactEvent ev) { return static_cast<uint16_t>((ev.word >> COMPACT_PIN_SHIFT) & 0xFF); }
+inline uint8_t compact_flags(GpioIrqCompactEvent ev) { return static_cast<uint8_t>((ev.word >> COMPACT_FLAGS_SHIFT) & 0x3); }
+inline uint32_t compact_seq_delta(GpioIrqCompactEvent ev) { return static_cast<uint32_t>(ev.word >> COMPACT_SEQ_SHIFT); }
+
+// Extends a 48-bit compact timestamp to 64 bits against a nearby full one
+// (tolerates records slightly older than the reference)
+inline uint64_t compact_extend_timestamp(uint64_t low48, uint64_t reference) {
+    int64_t delta = static_cast<int64_t>((low48 - reference) << (64 - COMPACT_TS_BITS)) >> (64 - COMPACT_TS_BITS);
+    return reference + static_cast<uint64_t>(delta);
+}
+
+// Timestamp unit of a ring, published in the header page. Conversion is
+// the identity in ns mode.
+struct RingClock {
+    uint32_t mode = CLOCK_MODE_NS;
+    uint64_t freq_hz = 1000000000u;
+    uint64_t ref_ticks = 0;
+    uint64_t ref_ns = 0;
+
+    static RingClock from_meta(const SharedRingMeta& meta) {
+        RingClock clock;
+        clock.mode = meta.clock_mode;
+        clock.freq_hz = meta.counter_freq_hz ? meta.counter_freq_hz : 1000000000u;
+        clock.ref_ticks = meta.clock_ref_ticks;
+        clock.ref_ns = meta.clock_ref_ns;
+        return clock;
+    }
+
+    bool raw_ticks() const { return mode == CLOCK_MODE_TICKS; }
+
+    uint64_t delta_to_ns(uint64_t delta) const {
+        if (!raw_ticks()) return delta;
+        return static_cast<uint64_t>(static_cast<unsigned __int128>(delta) * 1000000000u / freq_hz);
+    }
+
+    // Converts an event timestamp to CLOCK_MONOTONIC ns
+    uint64_t to_ns(uint64_t timestamp) const {
+        if (!raw_ticks()) return timestamp;
+        int64_t delta = static_cast<int64_t>(timestamp - ref_ticks);
+        if (delta >= 0) return ref_ns + delta_to_ns(static_cast<uint64_t>(delta));
+        return ref_ns - delta_to_ns(static_cast<uint64_t>(-delta));
+    }
+
+    // Current time in the same unit and clock as event timestamps
+    uint64_t now() const {
+#if defined(__aarch64__)
+        if (raw_ticks()) {
+            uint64_t ticks;
+            __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0" : "=r"(ticks) : : "memory");
+            return ticks;
+        }
+#endif
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + static_cast<uint64_t>(ts.tv_nsec);
+    }
+};
+
+// Linear map from ring timestamps to the sync clock (SYNC_CLOCK_TAI ns),
+// through the module's latest clock pair with the rate measured between the
+// two latest pairs: the drift of the ring clock is corrected, the
+// conversion costs one multiply.
+struct SyncClock {
+    // A larger rate error is a step of the sync clock (ptp4l locking, a
+    // manual set), not drift: the nominal rate is used instead
+    static constexpr uint64_t MAX_RATE_ERROR_PPM = 500;
+
+    uint32_t sync_clock = SYNC_CLOCK_NONE;
+    uint64_t samples = 0;          // Pairs taken by the module, 0 = no map yet
+    uint64_t ref_timestamp = 0;    // Latest pair
+    uint64_t ref_sync_ns = 0;
+    uint64_t rate = 0;             // Sync ns per timestamp unit, 32.32 fixed point
+    uint32_t uncertainty_ns = 0;   // Read window of the latest pair
+
+    static SyncClock from_pairs(const SharedRingClockSync& entry, const RingClock& clock) {
+        SyncClock sync;
+        sync.sync_clock = entry.sync_clock;
+        sync.samples = entry.samples;
+        sync.ref_timestamp = entry.last_timestamp;
+        sync.ref_sync_ns = entry.last_sync_ns;
+        sync.uncertainty_ns = entry.uncertainty_ns;
+
+        const uint64_t nominal = static_cast<uint64_t>((static_cast<unsigned __int128>(1000000000u) << 32) / clock.freq_hz);
+        sync.rate = nominal;
+        if (entry.samples >= 2 && entry.last_timestamp > entry.prev_timestamp && entry.last_sync_ns > entry.prev_sync_ns) {
+            const uint64_t measured = static_cast<uint64_t>((static_cast<unsigned __int128>(entry.last_sync_ns - entry.prev_sync_ns) << 32) /
+                                                            (entry.last_timestamp - entry.prev_timestamp));
+            const uint64_t error = (measured > nominal) ? measured - nominal : nominal - measured;
+            if (error <= nominal / 1000000u * MAX_RATE_ERROR_PPM) sync.rate = measured;
+        }
+        return sync;
+    }
+
+    bool valid() const { return sync_clock != SYNC_CLOCK_NONE && samples != 0; }
+
+    // Event timestamp to sync clock ns, before or after the reference pair
+    uint64_t to_sync_ns(uint64_t timestamp) const {
+        const int64_t delta = static_cast<int64_t>(timestamp - ref_timestamp);
+        const __int128 scaled = (static_cast<__int128>(delta) * static_cast<__int128>(rate)) >> 32;
+        return ref_sync_ns + static_cast<uint64_t>(static_cast<int64_t>(scaled));
+    }
+};
+
+// Seqlock read of the clock pairs published by the module; returns the
+// (even) sequence number the copy belongs to
+inline uint32_t read_clock_sync(const SharedRingClockSync& entry, SharedRingClockSync& out) {
+    uint32_t seq;
+
+    do {
+        seq = __atomic_load_n(&entry.seq, __ATOMIC_ACQUIRE);
+        out.sync_clock = __atomic_load_n(&entry.sync_clock, __ATOMIC_RELAXED);
+        out.period_ns = __atomic_load_n(&entry.period_ns, __ATOMIC_RELAXED);
+        out.samples = __atomic_load_n(&entry.samples, __ATOMIC_RELAXED);
+        out.prev_timestamp = __atomic_load_n(&entry.prev_timestamp, __ATOMIC_RELAXED);
+        out.prev_sync_ns = __atomic_load_n(&entry.prev_sync_ns, __ATOMIC_RELAXED);
+        out.last_timestamp = __atomic_load_n(&entry.last_timestamp, __ATOMIC_RELAXED);
+        out.last_sync_ns = __atomic_load_n(&entry.last_sync_ns, __ATOMIC_RELAXED);
+        out.uncertainty_ns = __atomic_load_n(&entry.uncertainty_ns, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1u) || seq != __atomic_load_n(&entry.seq, __ATOMIC_RELAXED));
+
+    out.seq = seq;
+    return seq;
+}
+
+// Consistent copy of one SharedRingPinStats entry
+struct PinSample {
+    uint32_t event_count;
+    uint32_t recorded_count;
+    uint32_t filtered_count;
+    uint64_t last_timestamp;
+};
+
+// Seqlock read of the per-pin counters published by the ISR
+inline PinSample read_pin_sample(const SharedRingPinStats& stats) {
+    PinSample sample;
+    uint32_t seq;
+
+    do {
+        seq = __atomic_load_n(&stats.seq, __ATOMIC_ACQUIRE);
+        sample.event_count = __atomic_load_n(&stats.event_count, __ATOMIC_RELAXED);
+        sample.recorded_count = __atomic_load_n(&stats.recorded_count, __ATOMIC_RELAXED);
+        sample.filtered_count = __atomic_load_n(&stats.filtered_count, __ATOMIC_RELAXED);
+        sample.last_timestamp = __atomic_load_n(&stats.last_timestamp, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1u) || seq != __atomic_load_n(&stats.seq, __ATOMIC_RELAXED));
+
+    return sample;
+}
+
+// Data-loss counters, see RpiFastIrq::ring_stats()
+struct RingStats {
+    uint64_t kernel_overruns;  // Counted by the ISR when it found the ring full
+    uint64_t reader_skipped;   // Overwritten events skipped by this listener (overwrite policy)
+    uint32_t high_water;       // Highest fill level seen by the ISR
+    uint32_t capacity;
+    uint32_t overflow_policy;
+};
+
+// Stage timestamps of one event in CLOCK_MONOTONIC ns, see start_traced()
+struct LatencyTrace {
+    uint64_t isr_entry_ns;     // ISR entry, the event timestamp
+    uint64_t wakeup_ns;        // ISR issued the wakeup; 0 if this event did not wake a reader
+    uint64_t isr_exit_ns;      // ISR returned
+    uint64_t poll_return_ns;   // Listener saw the batch: poll() returned or the spin saw head move
+    uint64_t callback_ns;      // Just before the callback
+    bool kernel_valid;         // false if the ISR had not finished the trace record yet
+};
+
+// How the listener thread waits for new events
+enum class WaitMode {
+    Poll,    // Sleep in poll(), woken by the ISR (default, 0% CPU when idle)
+    Spin,    // Busy-poll head with WFE/YIELD hints, no wakeup on the hot path
+    Hybrid   // Spin for spin_us after the last event, then fall back to poll()
+};
+
+struct ListenerConfig {
+    WaitMode wait_mode = WaitMode::Poll;
+    uint32_t spin_us = 100;  // Hybrid only: spin window after the last event
+    bool use_wfe = true;     // AArch64: WFE on the head cache line instead of YIELD
+    int cpu = -1;            // Pin the listener thread to this CPU, -1 = no pinning
+    int sched_policy = SCHED_FIFO;  // SCHED_FIFO, SCHED_RR or SCHED_OTHER
+    int priority = -1;       // RT priority, -1 = maximum of sched_policy
+    bool lock_memory = false;       // mlockall(MCL_CURRENT | MCL_FUTURE) at start(), mlock() of the ring (also open())
+    size_t prefault_stack = 0;      // Bytes of listener stack touched before the loop
+    bool prefault_ring = true;      // MAP_POPULATE and one read per ring page when mapping (start() and open())
+    bool self_check = true;  // Report the CPU isolation state at start()
+};
+
+// CPU isolation state seen by start(), see RpiFastIrq::isolation_report()
+struct IsolationReport {
+    uint32_t capture_engine; // CAPTURE_ENGINE_* running in the module
+    int irq_cpu;             // From the module (irq_cpu parameter), -1 = not bound
+    bool irq_cpu_isolated;   // irq_cpu listed in isolcpus
+    bool irq_affinity_ok;    // Every pin IRQ's effective affinity is irq_cpu (ISR engine only, else true)
+    int listener_cpu;        // ListenerConfig::cpu
+    bool listener_cpu_isolated;
+    bool irqbalance_running;
+};
+
+class RpiFastIrq {
+public:
+    using IrqCallback = std::function<void(const GpioIrqEvent&)>;
+    // Receives a contiguous span of ring slots, read in place (zero-copy).
+    // A wakeup yields one span, or two when the pending range wraps.
+    using BatchCallback = std::function<void(const GpioIrqEvent* first, size_t count)>;
+    using CompactBatchCallback = std::function<void(const GpioIrqCompactEvent* first, size_t count)>;
+    using TraceCallback = std::function<void(const GpioIrqEvent&, const LatencyTrace&)>;
+
+    static constexpr uint32_t ALL_PINS = 0xFFFFFFFFu;
+    static constexpr uint32_t pin_bit(unsigned pin_index) { return 1u << pin_index; }
+
+    explicit RpiFastIrq(const std::string& device_path = "/dev/rp1_gpio_irq");
+    ~RpiFastIrq();
+
+    RpiFastIrq(const RpiFastIrq&) = delete;
+    RpiFastIrq& operator=(const RpiFastIrq&) = delete;
+
+    bool start(IrqCallback user_callback);
+    // Batched variant: one indirect call per span instead of per event and a
+    // single tail release per wakeup. Spans are not filtered by subscribe();
+    // check pin_index in the callback. The slots stay valid until the callback
+    // returns, unless the ISR laps the reader (overwrite policy).
+    bool start_batch(BatchCallback batch_callback);
+    // Same for a module loaded with event_format=1: the spans hold the raw
+    // 8-byte records (see compact_* helpers). start() works with both formats
+    // and decodes compact records into GpioIrqEvent; the event_counter it
+    // rebuilds from the sequence deltas is seeded from the pin stats, so it
+    // matches the legacy counter (up to saturated deltas).
+    bool start_compact_batch(CompactBatchCallback batch_callback);
+    // Instrumented variant of start() for a module loaded with
+    // trace_latency=1: the callback also receives the ISR, wakeup, listener
+    // and callback times of each event. Costs two clock reads per event.
+    bool start_traced(TraceCallback trace_callback);
+    void stop();
+
+    // Threadless mode: maps the ring without a listener thread. Register
+    // fd() for EPOLLIN in an external reactor and call drain() when it is
+    // readable; the fd is readable while unread events are pending.
+    // stop() (or close()) unmaps. Not combinable with start*().
+    bool open();
+    void close() { stop(); }
+    int fd() const { return m_fd; }
+
+    // Visits every pending event of the subscribed pins in order, on the
+    // calling thread, then releases the tail. The visitor is called as
+    // visit(const GpioIrqEvent&) with a local copy of each record (legacy
+    // records are copied out of the ring, compact ones decoded), so the ISR
+    // lapping the reader cannot tear the event the visitor is reading.
+    // Returns the number of events visited.
+    template <typename Visitor>
+    size_t drain(Visitor&& visit);
+
+    // Listener wait strategy, CPU pinning and scheduling, applied by the
+    // next start()
+    bool configure(const ListenerConfig& config);
+
+    // Control plane (RPI_FAST_IRQ_IOC_*). Each call uses the open device
+    // when running, or opens it briefly otherwise. Changes apply to the
+    // module and therefore to every reader.
+
+    // In-kernel edge filter of one pin (edge selection, deadtime, prescale),
+    // see RpiFastIrqFilter
+    bool set_filter(const RpiFastIrqFilter& filter);
+    bool get_filter(uint32_t pin_index, RpiFastIrqFilter& out) const;
+    bool query_info(RpiFastIrqInfo& out) const;
+    bool reset_counters();                      // overruns, high_water, filtered counts
+    bool set_enabled_pins(uint32_t pin_mask);   // Enables/disables the pin IRQs (see pin_bit())
+    bool set_irq_cpu(int cpu);                  // -1 = drop the binding
+    // Rebuilds the ring empty, resized (0 = same size) and optionally with a
+    // new GPIO list. Only while stopped, and fails with EBUSY while any other
+    // process has the device open for reading or mapped (monitors included).
+    bool reconfigure_ring(uint32_t ring_size, const std::vector<int>& gpios = {});
+    // Schedule of the synthetic generator (module loaded with
+    // capture_engine=2), see RpiFastIrqSynth. rate_hz = 0 stops it.
+    bool set_synth(const RpiFastIrqSynth& synth);
+    bool get_synth(RpiFastIrqSynth& out) const;
+
+    // Reads isolcpus, the pin IRQ affinities (/proc/irq) and whether
+    // irqbalance runs. Valid after a successful start(); start() prints the
+    // result when ListenerConfig::self_check is set.
+    IsolationReport isolation_report() const;
+
+    // Restricts the callback to the pins whose bit is set (see pin_bit()).
+    // May be changed while running; takes effect on the next wakeup.
+    void subscribe(uint32_t pin_mask);
+
+    // Ring capacity in events, valid after a successful start()
+    uint32_t capacity() const { return m_mask + 1; }
+    uint32_t event_format() const { return m_event_format; }
+    // CAPTURE_ENGINE_PIO: the edges are timestamped in hardware by the RP1
+    // PIO, quantized to timestamp_resolution_ns() (0 for the ISR engine)
+    uint32_t capture_engine() const { return m_capture_engine; }
+    uint32_t timestamp_resolution_ns() const { return m_timestamp_resolution_ns; }
+
+    // Snapshot of the overflow accounting, safe to call from any thread
+    // while running. Returns zeros when stopped.
+    RingStats ring_stats() const;
+
+    // Timestamp conversion for raw-tick mode (identity in ns mode). The clock
+    // parameters are cached by start() and remain valid after stop().
+    const RingClock& clock() const { return m_clock; }
+    bool raw_ticks() const { return m_clock.raw_ticks(); }
+    uint64_t counter_freq_hz() const { return m_clock.freq_hz; }
+    uint64_t delta_to_ns(uint64_t delta) const { return m_clock.delta_to_ns(delta); }
+    uint64_t to_ns(uint64_t timestamp) const { return m_clock.to_ns(timestamp); }
+
+    // Timestamps on the synchronized clock, for a module loaded with
+    // sync_period_ms > 0 (sync_clock().valid()): CLOCK_TAI ns, as good as
+    // PTP keeps CLOCK_TAI of this node. The listener and drain() reload the
+    // map once per batch when the module has published a new pair, so use
+    // it from the thread that runs the callbacks. refresh_sync_clock() does
+    // the same check on demand and returns true when the map changed.
+    const SyncClock& sync_clock() const { return m_sync_clock; }
+    uint64_t to_sync_ns(uint64_t timestamp) const { return m_sync_clock.to_sync_ns(timestamp); }
+    bool refresh_sync_clock();
+
+private:
+    std::string m_device_path;
+    int m_fd;
+    SharedRingBuffer* m_shared_buf;
+    SharedRingConsumer* m_reader;           // Cursor slot claimed by this open file
+    GpioIrqEvent* m_events;                 // Valid with EVENT_FORMAT_LEGACY
+    GpioIrqCompactEvent* m_compact_events;  // Valid with EVENT_FORMAT_COMPACT
+    uint32_t m_event_format;
+    uint32_t m_capture_engine;
+    uint32_t m_timestamp_resolution_ns;
+    uint32_t m_mask;
+    size_t m_mmap_size;
+    std::atomic<bool> m_running;
+    bool m_threadless;
+    uint32_t m_drain_tail;
+    std::atomic<uint32_t> m_pin_mask;
+    std::atomic<uint64_t> m_reader_skipped;
+    ListenerConfig m_config;
+
+    RingClock m_clock;
+    SyncClock m_sync_clock;
+    uint32_t m_sync_seq;                    // clock_sync.seq m_sync_clock was built from
+    IrqCallback m_callback;
+    BatchCallback m_batch_callback;
+    CompactBatchCallback m_compact_batch_callback;
+    TraceCallback m_trace_callback;
+
+    // Latency tracing: per-slot ISR records (nullptr unless trace_latency)
+    // and the time the listener last saw new events
+    const GpioIrqTraceRecord* m_traces;
+    uint64_t m_poll_return_ns;
+
+    // Compact decoding state: timestamp reference and per-pin counters
+    uint64_t m_last_timestamp;
+    uint32_t m_pin_counters[256];
+    std::thread m_listener_thread;
+
+    bool prepare_start(int required_format);
+    bool map_device();
+    void prefault_mapping();
+    void unmap_device();
+    void launch_listener();
+    void apply_thread_config();
+    bool control(unsigned long request, void* arg, const char* what, bool writable) const;
+    uint32_t snapshot_recorded_counts(uint32_t* counters) const;
+    uint32_t attach_tail();
+    void listener_thread_func();
+    void poll_loop(uint32_t& local_tail);
+    void spin_loop(uint32_t& local_tail);
+    int wait_readable(int timeout_ms);
+    uint32_t claim_pending(uint32_t& local_tail, uint32_t& current_head);
+    void reseed_compact_counters(uint32_t& local_tail, uint32_t& current_head);
+    template <typename Visitor>
+    size_t visit_pending(uint32_t& local_tail, uint32_t current_head, Visitor& visit);
+    void dispatch_pending(uint32_t& local_tail);
+    void dispatch_traced(uint32_t& local_tail, uint32_t current_head);
+    GpioIrqEvent decode_compact(GpioIrqCompactEvent ev);
+
+    template <typename Event, typename Callback>
+    void deliver_spans(const Event* ring, uint32_t local_tail, uint32_t pending, Callback& callback) {
+        // Zero-copy: hand over the slots in place, split in two spans when
+        // the pending range wraps around the end of the ring
+        uint32_t first = local_tail & m_mask;
+        uint32_t span = capacity() - first;
+        if (span > pending) span = pending;
+
+        callback(&ring[first], span);
+        if (span < pending) {
+            callback(&ring[0], pending - span);
+        }
+    }
+};
+
+// Hot path: defined in the header so it inlines into the listener loops and,
+// with -flto, across the library boundary into the application
+
+inline uint32_t RpiFastIrq::claim_pending(uint32_t& local_tail, uint32_t& current_head) {
+    // With the overwrite policy the ISR may have lapped us: the
+    // oldest unread slots no longer hold our events, skip them.
+    uint32_t pending = current_head - local_tail;
+    if (pending > capacity()) {
+        m_reader_skipped.fetch_add(pending - capacity(), std::memory_order_relaxed);
+        local_tail = current_head - capacity();
+        pending = capacity();
+        // The skipped compact records took their sequence deltas with them
+        if (m_event_format == EVENT_FORMAT_COMPACT) reseed_compact_counters(local_tail, current_head);
+    }
+    return pending;
+}
+
+template <typename Visitor>
+size_t RpiFastIrq::visit_pending(uint32_t& local_tail, uint32_t current_head, Visitor& visit) {
+    uint32_t pin_mask = m_pin_mask.load(std::memory_order_relaxed);
+    size_t delivered = 0;
+
+    if (m_event_format == EVENT_FORMAT_COMPACT) {
+        while (local_tail != current_head) {
+            GpioIrqEvent event_data = decode_compact(m_compact_events[local_tail & m_mask]);
+            // 8-bit index in the record: bound it before shifting
+            if (event_data.pin_index < MAX_PINS && (pin_mask & pin_bit(event_data.pin_index))) {
+                visit(event_data);
+                delivered++;
+            }
+            local_tail++;
+        }
+    } else {
+        // Copy the 16-byte record before the visit: under the overwrite
+        // policy the ISR may rewrite the slot while the visitor reads it
+        while (local_tail != current_head) {
+            const GpioIrqEvent event_data = m_events[local_tail & m_mask];
+            if (event_data.pin_index < MAX_PINS && (pin_mask & pin_bit(event_data.pin_index))) {
+                visit(event_data);
+                delivered++;
+            }
+            local_tail++;
+        }
+    }
+
+    return delivered;
+}
+
+// One load per batch; the pairs are copied only after the module published
+inline bool RpiFastIrq::refresh_sync_clock() {
+    if (m_shared_buf == nullptr) return false;
+    if (__atomic_load_n(&m_shared_buf->clock_sync.seq, __ATOMIC_ACQUIRE) == m_sync_seq) return false;
+
+    SharedRingClockSync entry;
+    m_sync_seq = read_clock_sync(m_shared_buf->clock_sync, entry);
+    m_sync_clock = SyncClock::from_pairs(entry, m_clock);
+    return true;
+}
+
+inline void RpiFastIrq::dispatch_pending(uint32_t& local_tail) {
+    // Lock-free acquire barrier
+    uint32_t current_head = __atomic_load_n(&m_shared_buf->producer.head, __ATOMIC_ACQUIRE);
+
+    uint32_t pending = claim_pending(local_tail, current_head);
+    if (pending == 0) return;
+    refresh_sync_clock();
+
+    if (m_batch_callback) {
+        deliver_spans(m_events, local_tail, pending, m_batch_callback);
+        local_tail = current_head;
+    } else if (m_compact_batch_callback) {
+        deliver_spans(m_compact_events, local_tail, pending, m_compact_batch_callback);
+        local_tail = current_head;
+    } else if (m_callback) {
+        visit_pending(local_tail, current_head, m_callback);
+    } else if (m_trace_callback) {
+        dispatch_traced(local_tail, current_head);
+    } else {
+        local_tail = current_head;
+    }
+
+    // Lock-free release barrier updates tail for kernel space, once per batch
+    __atomic_store_n(&m_reader->tail, local_tail, __ATOMIC_RELEASE);
+}
+
+template <typename Visitor>
+size_t RpiFastIrq::drain(Visitor&& visit) {
+    if (!m_threadless) return 0;
+
+    uint32_t current_head = __atomic_load_n(&m_shared_buf->producer.head, __ATOMIC_ACQUIRE);
+    if (claim_pending(m_drain_tail, current_head) == 0) return 0;
+    refresh_sync_clock();
+
+    size_t delivered = visit_pending(m_drain_tail, current_head, visit);
+
+    // Releasing the tail re-arms POLLIN on fd() until the next event
+    __atomic_store_n(&m_reader->tail, m_drain_tail, __ATOMIC_RELEASE);
+    return delivered;
+}
+
+inline GpioIrqEvent RpiFastIrq::decode_compact(GpioIrqCompactEvent ev) {
+    GpioIrqEvent event_data{};
+
+    event_data.timestamp_ns = compact_extend_timestamp(compact_timestamp(ev), m_last_timestamp);
+    if (event_data.timestamp_ns > m_last_timestamp) m_last_timestamp = event_data.timestamp_ns;
+
+    event_data.pin_index = compact_pin_index(ev);
+    event_data.flags = compact_flags(ev);
+    m_pin_counters[event_data.pin_index] += compact_seq_delta(ev);
+    event_data.event_counter = m_pin_counters[event_data.pin_index];
+
+    return event_data;
+}
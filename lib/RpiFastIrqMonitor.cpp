@@ -0,0 +1,86 @@
+/**
+ * @file RpiFastIrqMonitor.cpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Implementation of the read-only rpi_fast_irq rate monitor.
+ * @requirements C++17, Linux OS, read access to the device node.
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RpiFastIrqMonitor.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+RpiFastIrqMonitor::RpiFastIrqMonitor(const std::string& device_path)
+    : m_device_path(device_path), m_header(nullptr), m_map_size(0), m_num_pins(0) {
+}
+
+RpiFastIrqMonitor::~RpiFastIrqMonitor() {
+    close();
+}
+
+bool RpiFastIrqMonitor::open() {
+    if (m_header != nullptr) return true;
+
+    // O_RDONLY: the kernel then refuses any writable mapping of this fd
+    int fd = ::open(m_device_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "\033[31m[RpiFastIrqMonitor] Failed to open device: " << m_device_path
+                  << " Error: " << std::strerror(errno) << "\033[0m\n";
+        return false;
+    }
+
+    m_map_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    void* header = ::mmap(NULL, m_map_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping outlives the descriptor
+    ::close(fd);
+
+    if (header == MAP_FAILED) {
+        std::cerr << "\033[31m[RpiFastIrqMonitor] mmap of header page failed: " << std::strerror(errno) << "\033[0m\n";
+        return false;
+    }
+
+    const SharedRingBuffer* buf = static_cast<const SharedRingBuffer*>(header);
+    if (buf->meta.magic != RING_LAYOUT_MAGIC || buf->meta.layout_version != RING_LAYOUT_VERSION) {
+        std::cerr << "\033[31m[RpiFastIrqMonitor] Ring layout version " << buf->meta.layout_version
+                  << " does not match library layout version " << RING_LAYOUT_VERSION
+                  << ". Rebuild against the loaded kernel module.\033[0m\n";
+        ::munmap(header, m_map_size);
+        return false;
+    }
+
+    m_header = buf;
+    m_num_pins = std::min<uint32_t>(buf->meta.num_pins, MAX_PINS);
+    m_clock = RingClock::from_meta(buf->meta);
+    return true;
+}
+
+void RpiFastIrqMonitor::close() {
+    if (m_header == nullptr) return;
+
+    ::munmap(const_cast<SharedRingBuffer*>(m_header), m_map_size);
+    m_header = nullptr;
+    m_num_pins = 0;
+}
+
+bool RpiFastIrqMonitor::sample(unsigned pin_index, PinSample& out) const {
+    if (m_header == nullptr || pin_index >= m_num_pins) return false;
+
+    out = read_pin_sample(m_header->pin_stats[pin_index]);
+    return true;
+}
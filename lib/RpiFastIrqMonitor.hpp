@@ -0,0 +1,58 @@
+/**
+ * @file RpiFastIrqMonitor.hpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Read-only, threadless access to the per-pin counters of the rpi_fast_irq header page.
+ * @requirements C++17
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "RpiFastIrq.hpp"
+
+// Maps only the header page, read-only, and never touches the ring tail:
+// any number of monitors can run next to the real consumer without a
+// listener thread or a wakeup. Rates come from two samples of the counters.
+class RpiFastIrqMonitor {
+public:
+    explicit RpiFastIrqMonitor(const std::string& device_path = "/dev/rp1_gpio_irq");
+    ~RpiFastIrqMonitor();
+
+    RpiFastIrqMonitor(const RpiFastIrqMonitor&) = delete;
+    RpiFastIrqMonitor& operator=(const RpiFastIrqMonitor&) = delete;
+
+    bool open();
+    void close();
+
+    // Entries of the "pins" module parameter, valid after open()
+    uint32_t num_pins() const { return m_num_pins; }
+
+    // Consistent snapshot of one pin's counters. Returns false when the
+    // monitor is closed or pin_index is out of range.
+    bool sample(unsigned pin_index, PinSample& out) const;
+
+    // Unit of PinSample::last_timestamp (cached by open())
+    const RingClock& clock() const { return m_clock; }
+    uint64_t delta_to_ns(uint64_t delta) const { return m_clock.delta_to_ns(delta); }
+
+private:
+    std::string m_device_path;
+    const SharedRingBuffer* m_header;
+    size_t m_map_size;
+    uint32_t m_num_pins;
+    RingClock m_clock;
+};
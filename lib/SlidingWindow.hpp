@@ -0,0 +1,86 @@
+/**
+ * @file SlidingWindow.hpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Fixed-capacity window of the last N samples with amortized O(1) min and max (monotonic deques).
+ * @requirements C++17
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Keeps the last capacity() (x, y) samples for a live plot that runs for
+// weeks: all memory is allocated by the constructor, push() overwrites the
+// oldest sample once the window is full. min_y()/max_y() come from two
+// monotonic deques of sample sequence numbers (increasing values for the
+// minimum, decreasing for the maximum), so each sample enters and leaves
+// each deque once. Not thread-safe.
+template <typename T>
+class SlidingWindow {
+public:
+    explicit SlidingWindow(size_t capacity)
+        : m_capacity(capacity ? capacity : 1), m_x(m_capacity), m_y(m_capacity),
+          m_min_deque(m_capacity), m_max_deque(m_capacity) {}
+
+    size_t capacity() const { return m_capacity; }
+    size_t size() const { return static_cast<size_t>(m_next - m_first); }
+    bool empty() const { return m_next == m_first; }
+
+    void push(double x, T y) {
+        if (size() == m_capacity) {
+            // Evict the oldest sample from the deque fronts as well
+            if (front(m_min_deque, m_min_head) == m_first) m_min_head++;
+            if (front(m_max_deque, m_max_head) == m_first) m_max_head++;
+            m_first++;
+        }
+
+        const uint64_t seq = m_next++;
+        m_x[seq % m_capacity] = x;
+        m_y[seq % m_capacity] = y;
+
+        while (m_min_tail != m_min_head && y_at(back(m_min_deque, m_min_tail)) >= y) m_min_tail--;
+        m_min_deque[m_min_tail++ % m_capacity] = seq;
+        while (m_max_tail != m_max_head && y_at(back(m_max_deque, m_max_tail)) <= y) m_max_tail--;
+        m_max_deque[m_max_tail++ % m_capacity] = seq;
+    }
+
+    // Sample i of the window, 0 = oldest. Valid for i < size().
+    double x(size_t i) const { return m_x[(m_first + i) % m_capacity]; }
+    T y(size_t i) const { return m_y[(m_first + i) % m_capacity]; }
+
+    // Extremes of the samples in the window; undefined when empty()
+    T min_y() const { return y_at(front(m_min_deque, m_min_head)); }
+    T max_y() const { return y_at(front(m_max_deque, m_max_head)); }
+
+    void clear() { m_first = m_next = m_min_head = m_min_tail = m_max_head = m_max_tail = 0; }
+
+private:
+    T y_at(uint64_t seq) const { return m_y[seq % m_capacity]; }
+    uint64_t front(const std::vector<uint64_t>& deque, uint64_t head) const { return deque[head % m_capacity]; }
+    uint64_t back(const std::vector<uint64_t>& deque, uint64_t tail) const { return deque[(tail - 1) % m_capacity]; }
+
+    size_t m_capacity;
+    std::vector<double> m_x;
+    std::vector<T> m_y;
+    uint64_t m_first = 0;   // Sequence number of the oldest sample
+    uint64_t m_next = 0;    // Sequence number of the next sample
+    // Circular deques of sequence numbers; never more than capacity() entries
+    std::vector<uint64_t> m_min_deque;
+    std::vector<uint64_t> m_max_deque;
+    uint64_t m_min_head = 0, m_min_tail = 0;
+    uint64_t m_max_head = 0, m_max_tail = 0;
+};
@@ -0,0 +1,153 @@
+/**
+ * @file SpscQueue.hpp
+ * @version 1.0.0
+ * @date 2026-10-14
+ * @author Leonardo Lisa
+ * @brief Bounded single-producer single-consumer queue with bulk operations and a futex-based blocking pop.
+ * @requirements C++17, Linux (futex)
+ * * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include <type_traits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hands events from the listener callback to a slower consumer thread.
+// Each index lives on its own cache line together with the side's cached
+// copy of the other index, so the producer only re-reads the tail when the
+// queue looks full and the consumer only re-reads the head when it looks
+// empty. A consumer with nothing to do sleeps on a futex instead of polling;
+// the producer pays for the wake syscall only while the consumer is asleep.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "SpscQueue elements must be trivially copyable");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit integer");
+
+    static constexpr size_t MASK = Capacity - 1;
+    static constexpr size_t CACHE_LINE = 64;
+
+public:
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Producer side. Returns false (nothing written) when the queue is full.
+    bool push(const T& item) { return push_n(&item, 1) == 1; }
+
+    // Producer side. Writes up to count items, returns how many fit.
+    size_t push_n(const T* items, size_t count) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        size_t free_slots = Capacity - (head - m_cached_tail);
+        if (free_slots < count) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            free_slots = Capacity - (head - m_cached_tail);
+        }
+        if (count > free_slots) count = free_slots;
+        if (count == 0) return 0;
+
+        for (size_t i = 0; i < count; ++i) m_data[(head + i) & MASK] = items[i];
+        m_head.store(head + count, std::memory_order_release);
+        notify_consumer();
+        return count;
+    }
+
+    // Consumer side. Returns false when the queue is empty.
+    bool pop(T& item) { return pop_n(&item, 1) == 1; }
+
+    // Consumer side. Reads up to max_count items, returns how many were read.
+    size_t pop_n(T* out, size_t max_count) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t available = m_cached_head - tail;
+        if (available < max_count) {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            available = m_cached_head - tail;
+        }
+        if (max_count > available) max_count = available;
+        if (max_count == 0) return 0;
+
+        for (size_t i = 0; i < max_count; ++i) out[i] = m_data[(tail + i) & MASK];
+        m_tail.store(tail + max_count, std::memory_order_release);
+        return max_count;
+    }
+
+    // Consumer side. Like pop_n(), but sleeps until the producer pushes,
+    // wake() is called or timeout_ms elapses (-1 = no timeout). Returns 0 on
+    // timeout or wake() with the queue still empty.
+    size_t wait_pop_n(T* out, size_t max_count, int timeout_ms = -1) {
+        size_t count = pop_n(out, max_count);
+        if (count) return count;
+
+        // Announce the sleep, then look again: either this second check sees
+        // the item, or the producer sees m_sleeping and bumps m_wake_seq, so
+        // the futex wait below returns immediately
+        const uint32_t seq = m_wake_seq.load(std::memory_order_acquire);
+        m_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        count = pop_n(out, max_count);
+        if (count == 0) {
+            futex_wait(seq, timeout_ms);
+            count = pop_n(out, max_count);
+        }
+        m_sleeping.store(false, std::memory_order_relaxed);
+        return count;
+    }
+
+    // Any thread. Unblocks a consumer sleeping in wait_pop_n(), e.g. on shutdown.
+    void wake() {
+        m_wake_seq.fetch_add(1, std::memory_order_release);
+        futex_wake();
+    }
+
+private:
+    void notify_consumer() {
+        // Pairs with the fence in wait_pop_n(): the head store above is
+        // ordered before the m_sleeping check
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_relaxed) && m_sleeping.exchange(false, std::memory_order_relaxed)) {
+            wake();
+        }
+    }
+
+    void futex_wait(uint32_t expected, int timeout_ms) {
+        struct timespec timeout;
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+        // EAGAIN (word already changed), EINTR and ETIMEDOUT all mean "look again"
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_wake_seq), FUTEX_WAIT_PRIVATE,
+                expected, timeout_ms < 0 ? nullptr : &timeout, nullptr, 0);
+    }
+
+    void futex_wake() {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_wake_seq), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    // Producer line: written by the producer, read by the consumer on empty
+    alignas(CACHE_LINE) std::atomic<size_t> m_head{0};
+    size_t m_cached_tail = 0;
+
+    // Consumer line: written by the consumer, read by the producer on full
+    alignas(CACHE_LINE) std::atomic<size_t> m_tail{0};
+    size_t m_cached_head = 0;
+
+    // Wakeup line: only touched when the consumer goes to sleep
+    alignas(CACHE_LINE) std::atomic<uint32_t> m_wake_seq{0};
+    std::atomic<bool> m_sleeping{false};
+
+    alignas(CACHE_LINE) T m_data[Capacity];
+};